@@ -0,0 +1,54 @@
+#pragma once
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+
+// Counts the heap allocations made through operator new and the bytes they asked for, read by the memory report. The global
+// operator new and delete are replaced below, so like every header here this one is compiled into a single translation unit.
+// The array, nothrow and sized forms of the standard library forward to these two, aligned allocations are not counted.
+class AllocationCounter {
+    public:
+        static long long GetAllocations();
+        static long long GetAllocatedBytes();
+        static void Record(size_t bytes);
+    private:
+        static std::atomic<long long> allocations;
+        static std::atomic<long long> allocatedBytes;
+};
+
+std::atomic<long long> AllocationCounter::allocations(0);
+std::atomic<long long> AllocationCounter::allocatedBytes(0);
+
+void AllocationCounter::Record(size_t bytes)
+{
+    // Only the totals matter, no ordering with other memory is needed.
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+long long AllocationCounter::GetAllocations()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+long long AllocationCounter::GetAllocatedBytes()
+{
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t bytes)
+{
+    AllocationCounter::Record(bytes);
+    void* memory = std::malloc(bytes > 0 ? bytes : 1);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
@@ -0,0 +1,433 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <charconv>
+#include "utility.hpp"
+#include "route.hpp"
+#include "station_graph.hpp"
+
+/*
+    Answers route queries without the menu, one query per line and one result line per query, in the same order.
+
+        route <from> <to> layover|ride    shortest route, weighted by layover + ride time or ride time only
+        at <from> <to> <HH:MM>            earliest arriving route leaving at or after the 24 hour time
+        window <from> <to> <HH:MM> <HH:MM>  every route leaving in the window that no other route beats on both departure and
+                                          arrival time, 24 hour times
+        board <station> <HH:MM> <count>   next trains leaving the station at or after the 24 hour time
+        reach <from> <to>                 any route exists
+        direct <from> <to>                nonstop route exists
+        name <id>                         station name for an id
+        id <name>                         station id for a name, compared like the menu lookup
+        cache                             route cache counters, "<hits> <misses> <evictions> <entries>"
+        add <from> <to> <HH:MM> <HH:MM>   runs a new train between the 24 hour times, prints its train number
+        cancel <train>                    cancels a train, numbered by its line in trains.dat from 0
+        delay <train> <minutes>           moves a train by the minutes, negative runs it earlier
+
+    Routes print "<minutes> <station>@<time>><station>@<time> ..." with one leg per field, or "none". window prints its routes
+    separated by " ; ". board prints "<to>@<departure>><arrival>" for each train, or "none". reach and direct print "yes" or "no",
+    name and id print the station or "none". cancel and delay print "ok", or "none"
+    when the train doesn't run or would leave the day, and every later query sees the change. A malformed query prints "error <reason>". Blank lines and lines starting with # are
+    skipped.
+*/
+
+class BatchQuery {
+    public:
+        BatchQuery(StationGraph& graph, const std::vector<StationRecord>& stations);
+        // Answers every query read from input and returns how many were answered.
+        int Run(std::istream& input, std::ostream& output);
+        // Appends the result for one query to result, without a line break.
+        void Answer(std::string_view query, std::string& result);
+    private:
+        StationGraph& stationGraph;
+        const std::vector<StationRecord>& stationLookupTable;
+        const int stationCount;
+        std::vector<std::string_view> tokens;
+        void split_tokens(std::string_view query);
+        bool parse_station_pair(std::pair<int, int>& stationPair) const;
+        bool parse_clock_time(std::string_view text, int& twentyFourTime) const;
+        void append_route(Route& tripRoute, bool includeLayovers, std::string& result);
+        static bool parse_int(std::string_view text, int& value);
+        static void append_int(int value, std::string& result, int width = 0);
+};
+
+BatchQuery::BatchQuery(StationGraph& graph, const std::vector<StationRecord>& stations)
+    : stationGraph(graph), stationLookupTable(stations), stationCount(stations.size())
+{
+}
+
+int BatchQuery::Run(std::istream& input, std::ostream& output)
+{
+    int answered = 0;
+    std::string line;
+    std::string result;
+    while (std::getline(input, line))
+    {
+        std::string_view query(line);
+        size_t start = query.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos || query[start] == '#')
+        {
+            continue;
+        }
+
+        result.clear();
+        Answer(query, result);
+        result.push_back('\n');
+        output.write(result.data(), result.size());
+        answered++;
+    }
+
+    output.flush();
+    return answered;
+}
+
+void BatchQuery::Answer(std::string_view query, std::string& result)
+{
+    split_tokens(query);
+    if (tokens.empty())
+    {
+        result += "error empty query";
+        return;
+    }
+
+    std::string_view command = tokens[0];
+    std::pair<int, int> stationPair;
+    if (command == "route")
+    {
+        if (tokens.size() != 4 || (tokens[3] != "layover" && tokens[3] != "ride"))
+        {
+            result += "error usage: route <from> <to> layover|ride";
+        }
+        else if (!parse_station_pair(stationPair))
+        {
+            result += "error invalid station id";
+        }
+        else
+        {
+            bool includeLayovers = tokens[3] == "layover";
+            Route tripRoute = stationGraph.GetShortestRoute(stationPair.first, stationPair.second, includeLayovers);
+            append_route(tripRoute, includeLayovers, result);
+        }
+    }
+    else if (command == "at")
+    {
+        int twentyFourTime = 0;
+        if (tokens.size() != 4)
+        {
+            result += "error usage: at <from> <to> <HH:MM>";
+        }
+        else if (!parse_station_pair(stationPair))
+        {
+            result += "error invalid station id";
+        }
+        else if (!parse_clock_time(tokens[3], twentyFourTime))
+        {
+            result += "error invalid time, must be in HH:MM format";
+        }
+        else
+        {
+            Route tripRoute = stationGraph.GetRouteFromTime(twentyFourTime, stationPair.first, stationPair.second);
+            append_route(tripRoute, true, result);
+        }
+    }
+    else if (command == "window")
+    {
+        int windowStart = 0;
+        int windowEnd = 0;
+        if (tokens.size() != 5)
+        {
+            result += "error usage: window <from> <to> <HH:MM> <HH:MM>";
+        }
+        else if (!parse_station_pair(stationPair))
+        {
+            result += "error invalid station id";
+        }
+        else if (!parse_clock_time(tokens[3], windowStart) || !parse_clock_time(tokens[4], windowEnd) || windowStart > windowEnd)
+        {
+            result += "error invalid window, must be two HH:MM times in order";
+        }
+        else
+        {
+            std::vector<Route> routes = stationGraph.GetRouteProfile(stationPair.first, stationPair.second, windowStart, windowEnd);
+            if (routes.empty())
+            {
+                result += "none";
+            }
+            for (int i = 0; i < routes.size(); i++)
+            {
+                if (i > 0)
+                {
+                    result += " ; ";
+                }
+                append_route(routes[i], true, result);
+            }
+        }
+    }
+    else if (command == "board")
+    {
+        int stationID = 0;
+        int twentyFourTime = 0;
+        int count = 0;
+        bool validQuery = tokens.size() == 4;
+        if (validQuery)
+        {
+            auto parsedID = std::from_chars(tokens[1].data(), tokens[1].data() + tokens[1].size(), stationID);
+            auto parsedCount = std::from_chars(tokens[3].data(), tokens[3].data() + tokens[3].size(), count);
+            validQuery = parsedID.ec == std::errc() && parsedID.ptr == tokens[1].data() + tokens[1].size() &&
+                parsedCount.ec == std::errc() && parsedCount.ptr == tokens[3].data() + tokens[3].size() && count > 0;
+        }
+
+        if (!validQuery)
+        {
+            result += "error usage: board <station> <HH:MM> <count>";
+        }
+        else if (stationID < 1 || stationID > stationCount)
+        {
+            result += "error invalid station id";
+        }
+        else if (!parse_clock_time(tokens[2], twentyFourTime))
+        {
+            result += "error invalid time, must be in HH:MM format";
+        }
+        else
+        {
+            std::vector<Connection> departures = stationGraph.GetDepartureBoard(stationID, twentyFourTime, count);
+            if (departures.empty())
+            {
+                result += "none";
+            }
+            for (int i = 0; i < departures.size(); i++)
+            {
+                if (i > 0)
+                {
+                    result.push_back(' ');
+                }
+                append_int(departures[i].arrivalStationID, result);
+                result.push_back('@');
+                append_int(departures[i].departureTime, result, 4);
+                result.push_back('>');
+                append_int(departures[i].arrivalTime, result, 4);
+            }
+        }
+    }
+    else if (command == "reach" || command == "direct")
+    {
+        if (tokens.size() != 3)
+        {
+            result += "error usage: ";
+            result += command;
+            result += " <from> <to>";
+        }
+        else if (!parse_station_pair(stationPair))
+        {
+            result += "error invalid station id";
+        }
+        else
+        {
+            bool exists = command == "reach" ? stationGraph.PathExists(stationPair.first, stationPair.second)
+                                             : stationGraph.DirectPathExists(stationPair.first, stationPair.second);
+            result += exists ? "yes" : "no";
+        }
+    }
+    else if (command == "name")
+    {
+        int stationID = 0;
+        bool validID = false;
+        if (tokens.size() == 2)
+        {
+            auto parsed = std::from_chars(tokens[1].data(), tokens[1].data() + tokens[1].size(), stationID);
+            validID = parsed.ec == std::errc() && parsed.ptr == tokens[1].data() + tokens[1].size();
+        }
+
+        if (!validID)
+        {
+            result += "error usage: name <id>";
+        }
+        else if (stationID < 1 || stationID > stationCount)
+        {
+            result += "none";
+        }
+        else
+        {
+            result += stationLookupTable[stationID - 1].name;
+        }
+    }
+    else if (command == "id")
+    {
+        if (tokens.size() < 2)
+        {
+            result += "error usage: id <name>";
+            return;
+        }
+
+        // Names can hold spaces, everything after the command is the name.
+        std::string stationName(tokens[1].data(), tokens.back().data() + tokens.back().size() - tokens[1].data());
+        for (const StationRecord& station : stationLookupTable)
+        {
+            if (Utility::CompareStringsNoCase(station.name, stationName))
+            {
+                append_int(station.stationID, result);
+                return;
+            }
+        }
+        result += "none";
+    }
+    else if (command == "add")
+    {
+        int departureTime = 0;
+        int arrivalTime = 0;
+        if (tokens.size() != 5)
+        {
+            result += "error usage: add <from> <to> <HH:MM> <HH:MM>";
+        }
+        else if (!parse_station_pair(stationPair))
+        {
+            result += "error invalid station id";
+        }
+        else if (!parse_clock_time(tokens[3], departureTime) || !parse_clock_time(tokens[4], arrivalTime) || departureTime > arrivalTime)
+        {
+            result += "error invalid time, must be in HH:MM format and arrive after departing";
+        }
+        else
+        {
+            append_int(stationGraph.AddTrain(stationPair.first, stationPair.second, departureTime, arrivalTime), result);
+        }
+    }
+    else if (command == "cancel" || command == "delay")
+    {
+        int trainNumber = 0;
+        int delayMinutes = 0;
+        bool validQuery = command == "cancel" ? tokens.size() == 2 && parse_int(tokens[1], trainNumber)
+                                              : tokens.size() == 3 && parse_int(tokens[1], trainNumber) && parse_int(tokens[2], delayMinutes);
+        if (!validQuery)
+        {
+            result += command == "cancel" ? "error usage: cancel <train>" : "error usage: delay <train> <minutes>";
+        }
+        else
+        {
+            bool updated = command == "cancel" ? stationGraph.CancelTrain(trainNumber) : stationGraph.DelayTrain(trainNumber, delayMinutes);
+            result += updated ? "ok" : "none";
+        }
+    }
+    else if (command == "cache")
+    {
+        RouteCacheStats stats = stationGraph.GetRouteCacheStats();
+        result += std::to_string(stats.hits) + ' ' + std::to_string(stats.misses) + ' ' +
+            std::to_string(stats.evictions) + ' ' + std::to_string(stats.entries);
+    }
+    else
+    {
+        result += "error unknown query ";
+        result += command;
+    }
+}
+
+void BatchQuery::split_tokens(std::string_view query)
+{
+    tokens.clear();
+    size_t position = 0;
+    while (true)
+    {
+        size_t start = query.find_first_not_of(" \t\r", position);
+        if (start == std::string_view::npos)
+        {
+            break;
+        }
+        size_t end = query.find_first_of(" \t\r", start);
+        if (end == std::string_view::npos)
+        {
+            end = query.size();
+        }
+        tokens.push_back(query.substr(start, end - start));
+        position = end;
+    }
+}
+
+bool BatchQuery::parse_station_pair(std::pair<int, int>& stationPair) const
+{
+    std::string_view from = tokens[1];
+    std::string_view to = tokens[2];
+    auto fromResult = std::from_chars(from.data(), from.data() + from.size(), stationPair.first);
+    auto toResult = std::from_chars(to.data(), to.data() + to.size(), stationPair.second);
+    if (fromResult.ec != std::errc() || fromResult.ptr != from.data() + from.size() ||
+        toResult.ec != std::errc() || toResult.ptr != to.data() + to.size())
+    {
+        return false;
+    }
+
+    // Same check the menu prompts make, station ids run from 1 to the number of stations.
+    return stationPair.first >= 1 && stationPair.first <= stationCount &&
+           stationPair.second >= 1 && stationPair.second <= stationCount;
+}
+
+bool BatchQuery::parse_int(std::string_view text, int& value)
+{
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+    return parsed.ec == std::errc() && parsed.ptr == text.data() + text.size();
+}
+
+// HH:MM as written, 00:00 to 23:59.
+bool BatchQuery::parse_clock_time(std::string_view text, int& twentyFourTime) const
+{
+    if (text.size() != 5 || text[2] != ':')
+    {
+        return false;
+    }
+
+    int hour = 0;
+    int minute = 0;
+    auto hourResult = std::from_chars(text.data(), text.data() + 2, hour);
+    auto minuteResult = std::from_chars(text.data() + 3, text.data() + 5, minute);
+    if (hourResult.ec != std::errc() || hourResult.ptr != text.data() + 2 ||
+        minuteResult.ec != std::errc() || minuteResult.ptr != text.data() + 5 ||
+        hour > 23 || minute > 59)
+    {
+        return false;
+    }
+
+    twentyFourTime = hour * 100 + minute;
+    return true;
+}
+
+void BatchQuery::append_route(Route& tripRoute, bool includeLayovers, std::string& result)
+{
+    if (!tripRoute.RouteIsValid())
+    {
+        result += "none";
+        return;
+    }
+
+    int totalTripMins = 0;
+    for (const TripPlusLayover& trip : tripRoute.tripList)
+    {
+        totalTripMins += includeLayovers ? trip.tripWeight : trip.rideTimeToDestinationMins;
+    }
+    append_int(totalTripMins, result);
+
+    // Same legs print_itinerary prints in Schedule, arrival is the departure time plus the ride time.
+    for (int i = 0; i < tripRoute.tripList.size(); i++)
+    {
+        const RouteStop& start = tripRoute.stops[i];
+        result.push_back(' ');
+        append_int(start.stationID, result);
+        result.push_back('@');
+        append_int(start.departureTime, result, 4);
+        result.push_back('>');
+        append_int(tripRoute.stops[i + 1].stationID, result);
+        result.push_back('@');
+        append_int(start.departureTime + tripRoute.tripList[i].rideTimeToDestinationMins, result, 4);
+    }
+}
+
+void BatchQuery::append_int(int value, std::string& result, int width)
+{
+    char buffer[16];
+    auto converted = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    int digits = converted.ptr - buffer;
+    if (digits < width)
+    {
+        result.append(width - digits, '0');
+    }
+    result.append(buffer, digits);
+}
@@ -0,0 +1,282 @@
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "schedule.hpp"
+
+// Builds deterministic synthetic timetables at several sizes and topologies, loads each one with every engine that can handle it and
+// times the load phases and each public StationGraph query. Prints one JSON object per timetable and engine.
+
+struct BenchEngine {
+    std::string name;
+    RouteEngine engine;
+    // Largest timetable the engine is run on, the table building engines grow too fast for the larger ones.
+    int maxTrains;
+};
+
+struct BenchNetwork {
+    std::string topology;
+    int trainCount;
+    int stationCount;
+    std::string stationsPath;
+    std::string trainsPath;
+};
+
+// Station pairs joined by track, both directions. line is a chain, grid a square lattice, hub a meshed core of hubs with the other
+// stations each hanging off one hub.
+static std::vector<std::pair<int, int>> make_links(const std::string& topology, int stationCount)
+{
+    std::vector<std::pair<int, int>> links;
+    if (topology == "line")
+    {
+        for (int i = 1; i < stationCount; i++)
+        {
+            links.push_back({i, i + 1});
+        }
+    }
+    else if (topology == "grid")
+    {
+        int width = (int)std::ceil(std::sqrt((double)stationCount));
+        for (int i = 1; i <= stationCount; i++)
+        {
+            if (i % width != 0 && i + 1 <= stationCount)
+            {
+                links.push_back({i, i + 1});
+            }
+            if (i + width <= stationCount)
+            {
+                links.push_back({i, i + width});
+            }
+        }
+    }
+    else
+    {
+        int hubCount = std::max(2, stationCount / 10);
+        for (int i = 1; i <= hubCount; i++)
+        {
+            for (int j = i + 1; j <= hubCount; j++)
+            {
+                links.push_back({i, j});
+            }
+        }
+        for (int i = hubCount + 1; i <= stationCount; i++)
+        {
+            links.push_back({i, (i - 1) % hubCount + 1});
+        }
+    }
+
+    int oneWayCount = links.size();
+    for (int i = 0; i < oneWayCount; i++)
+    {
+        links.push_back({links[i].second, links[i].first});
+    }
+    return links;
+}
+
+static std::string format_time(int dayMinutes)
+{
+    std::string time = std::to_string(dayMinutes / 60 * 100 + dayMinutes % 60);
+    return std::string(4 - time.size(), '0') + time;
+}
+
+// Trains run on random links at random times, 5 to 60 minutes each, and all arrive before midnight. Only the raw generator output is
+// used so the files are the same with every standard library.
+static BenchNetwork write_network(const std::string& directory, const std::string& topology, int trainCount, unsigned seed)
+{
+    BenchNetwork network;
+    network.topology = topology;
+    network.trainCount = trainCount;
+    network.stationCount = std::max(10, trainCount / 50);
+    network.stationsPath = directory + "/" + topology + "_" + std::to_string(trainCount) + "_stations.dat";
+    network.trainsPath = directory + "/" + topology + "_" + std::to_string(trainCount) + "_trains.dat";
+
+    std::ofstream stations(network.stationsPath);
+    for (int i = 1; i <= network.stationCount; i++)
+    {
+        stations << i << " station_" << i << '\n';
+    }
+
+    std::vector<std::pair<int, int>> links = make_links(topology, network.stationCount);
+    std::mt19937 generator(seed);
+    std::ofstream trains(network.trainsPath);
+    for (int i = 0; i < trainCount; i++)
+    {
+        const std::pair<int, int>& link = links[generator() % links.size()];
+        int rideMinutes = 5 + generator() % 56;
+        int departure = generator() % (24 * 60 - rideMinutes);
+        trains << link.first << ' ' << link.second << ' ' << format_time(departure) << ' ' << format_time(departure + rideMinutes) << '\n';
+    }
+
+    if (!stations || !trains)
+    {
+        throw std::runtime_error("could not write the timetables to " + directory);
+    }
+    return network;
+}
+
+// Runs query with increasing indexes until count calls are done or the time budget is spent, at least once.
+static void time_query(const std::string& name, int count, double budgetSeconds, const std::function<void(int)>& query, std::ostream& output,
+    bool first)
+{
+    auto start = std::chrono::steady_clock::now();
+    double elapsedSeconds = 0;
+    int calls = 0;
+    while (calls < count && (calls == 0 || elapsedSeconds < budgetSeconds))
+    {
+        query(calls);
+        calls++;
+        elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    output << (first ? "\"" : ", \"") << name << "\": {\"calls\": " << calls << ", \"seconds\": " << elapsedSeconds
+           << ", \"mean_us\": " << elapsedSeconds * 1e6 / calls << '}';
+}
+
+static void run_queries(StationGraph& graph, int stationCount, int tripCount, int queryCount, double budgetSeconds, unsigned seed, std::ostream& output)
+{
+    std::mt19937 generator(seed);
+    std::vector<int> from(queryCount);
+    std::vector<int> to(queryCount);
+    std::vector<int> times(queryCount);
+    std::vector<int> keys(queryCount);
+    for (int i = 0; i < queryCount; i++)
+    {
+        from[i] = 1 + generator() % stationCount;
+        to[i] = 1 + generator() % stationCount;
+        times[i] = (generator() % 24) * 100 + generator() % 60;
+        keys[i] = generator() % tripCount;
+    }
+
+    // Results are summed so the calls can't be optimised away.
+    long long checksum = 0;
+    output << "{";
+    time_query("GetShortestRoute_layover", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetShortestRoute(from[i], to[i], true).tripList.size(); }, output, true);
+    time_query("GetShortestRoute_ride", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetShortestRoute(from[i], to[i], false).tripList.size(); }, output, false);
+    time_query("GetRouteFromTime", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetRouteFromTime(times[i], from[i], to[i]).tripList.size(); }, output, false);
+    time_query("GetRoutesByTransfers", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetRoutesByTransfers(from[i], to[i], 2).size(); }, output, false);
+    time_query("GetRouteProfile", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetRouteProfile(from[i], to[i], times[i], std::min(2359, times[i] + 300)).size(); }, output, false);
+    time_query("GetDepartureBoard", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetDepartureBoard(from[i], times[i], 10).size(); }, output, false);
+    time_query("PathExists", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.PathExists(from[i], to[i]); }, output, false);
+    time_query("DirectPathExists", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.DirectPathExists(from[i], to[i]); }, output, false);
+    time_query("GetStationFromGraph", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetStationFromGraph(from[i]).GetID(); }, output, false);
+    time_query("GetStationFromArrivalGraph", queryCount, budgetSeconds,
+        [&](int i) { checksum += graph.GetStationFromArrivalGraph(from[i]).GetID(); }, output, false);
+    if (graph.HasDepartureGraph())
+    {
+        time_query("GetDepartureFromGraph", queryCount, budgetSeconds,
+            [&](int i) { checksum += graph.GetDepartureFromGraph(keys[i]).GetTripCount(); }, output, false);
+    }
+    output << "}, \"checksum\": " << checksum;
+}
+
+int main(int argc, char** argv)
+{
+    int maxTrains = 100000;
+    int queryCount = 200;
+    double budgetSeconds = 2;
+    unsigned seed = 1;
+    // Generated timetables go to the temporary directory, they are rebuilt from the seed on every run.
+    const char* temporaryDirectory = std::getenv("TMPDIR");
+    std::string directory = std::string(temporaryDirectory && *temporaryDirectory ? temporaryDirectory : "/tmp") + "/schedule_bench_data";
+    bool validArgs = true;
+    for (int i = 1; i + 1 < argc && validArgs; i += 2)
+    {
+        std::string flag = argv[i];
+        if (flag == "--max-trains")
+        {
+            maxTrains = std::atoi(argv[i + 1]);
+        }
+        else if (flag == "--queries")
+        {
+            queryCount = std::max(1, std::atoi(argv[i + 1]));
+        }
+        else if (flag == "--budget")
+        {
+            budgetSeconds = std::atof(argv[i + 1]);
+        }
+        else if (flag == "--seed")
+        {
+            seed = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (flag == "--data")
+        {
+            directory = argv[i + 1];
+        }
+        else
+        {
+            validArgs = false;
+        }
+    }
+    if (!validArgs || argc % 2 == 0)
+    {
+        std::cout << "useage: ./bench.out [--max-trains n] [--queries n] [--budget seconds per query type] [--seed n] [--data directory]\n";
+        return 0;
+    }
+    mkdir(directory.c_str(), 0755);
+
+    const std::vector<BenchEngine> engines = {
+        {"fw", RouteEngine::FloydWarshall, 1000},
+        {"tp", RouteEngine::TransferPatterns, 10000},
+        {"csa", RouteEngine::ConnectionScan, 100000},
+        {"dijkstra", RouteEngine::Dijkstra, 100000},
+        {"lazy", RouteEngine::LazyTrees, 100000}};
+    const std::vector<std::string> topologies = {"grid", "hub", "line"};
+
+    for (int trainCount = 100; trainCount <= maxTrains; trainCount *= 10)
+    {
+        for (const std::string& topology : topologies)
+        {
+            BenchNetwork network;
+            try
+            {
+                network = write_network(directory, topology, trainCount, seed + trainCount);
+            }
+            catch (const std::runtime_error& error)
+            {
+                std::cerr << error.what() << std::endl;
+                return 1;
+            }
+
+            for (const BenchEngine& engine : engines)
+            {
+                if (trainCount > engine.maxTrains)
+                {
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                Schedule schedule(network.stationsPath, network.trainsPath, engine.engine);
+                double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                std::cout << "{\"topology\": \"" << topology << "\", \"trains\": " << trainCount << ", \"stations\": " << network.stationCount
+                          << ", \"engine\": \"" << engine.name << "\", \"load_seconds\": " << loadSeconds << ", \"profile\": ";
+                schedule.GetLoadProfile().WriteJson(std::cout);
+                // The peak resident set only grows, so it is the largest of the runs so far rather than this one's.
+                std::cout << ", \"memory\": ";
+                schedule.GetMemoryReport().WriteJson(std::cout);
+                std::cout << ", \"queries\": ";
+                run_queries(schedule.GetStationGraph(), network.stationCount, trainCount, queryCount, budgetSeconds, seed, std::cout);
+                std::cout << "}" << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "trip.hpp"
+#include "departure_graph.hpp"
+#include "sequence_table.hpp"
+#include "timetable_reader.hpp"
+
+/*
+    Binary form of a fully built timetable: stations, trips, the departure graph and both shortest path sequence tables. Written once by
+    schedule.out --compile, then mapped read-only at startup so nothing has to be parsed or recomputed. The sequence tables are used
+    straight from the mapping, only the small sections are copied out.
+
+    Layout, every section starts on an 8 byte boundary:
+        header
+        station ids             int32[stationCount]
+        station name offsets    uint32[stationCount + 1] into the names section
+        station names           char[nameBytes]
+        trips                   Connection[tripCount]
+        vertex station ids      int32[vertexCount]
+        vertex departure times  int32[vertexCount]
+        edge offsets            uint32[vertexCount + 1] into the edges section
+        edges                   TripPlusLayover[edgeCount]
+        with layover table      uint16 or uint32[vertexCount * vertexCount], see SequenceTable::GetEntryBytes
+        without layover table   uint16 or uint32[vertexCount * vertexCount]
+
+    Values are stored in the byte order of the machine that compiled the file, byteOrderMark lets a different machine reject it.
+    dataChecksum covers every section before the tables and is always checked, tableChecksum covers the tables and is only checked
+    on request since it means reading the whole file.
+*/
+
+class CompiledTimetable {
+    public:
+        static const uint32_t FORMAT_VERSION = 2;
+        // Maps path and validates it, throws std::runtime_error if it isn't a compiled timetable this build can use.
+        CompiledTimetable(const std::string& path, bool verifyTables);
+        static void Write(const std::string& path, const std::vector<StationRecord>& stations, const std::vector<Connection>& trips,
+            const DepartureGraph& departures, const SequenceTable& withLayoverTable, const SequenceTable& withoutLayoverTable);
+        void ReadStations(std::vector<StationRecord>& stations) const;
+        void ReadTrips(std::vector<Connection>& trips) const;
+        void ReadDepartures(DepartureGraph& departures) const;
+        const void* GetSequenceTableData(bool includeLayovers) const;
+        int GetVertexCount() const;
+    private:
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrderMark;
+            uint32_t stationCount;
+            uint32_t tripCount;
+            uint32_t vertexCount;
+            uint32_t edgeCount;
+            uint64_t nameBytes;
+            uint64_t dataChecksum;
+            uint64_t tableChecksum;
+        };
+        // Byte offset of every section from the start of the file.
+        struct Layout {
+            size_t stationIDs;
+            size_t nameOffsets;
+            size_t names;
+            size_t trips;
+            size_t vertexStations;
+            size_t vertexTimes;
+            size_t edgeOffsets;
+            size_t edges;
+            size_t withLayoverTable;
+            size_t withoutLayoverTable;
+            size_t fileSize;
+        };
+        static constexpr char MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'T', 'T', '\0'};
+        static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+        static const uint64_t CHECKSUM_SEED = 14695981039346656037ull;
+        static Layout compute_layout(const Header& header);
+        static uint64_t checksum(uint64_t hash, const char* bytes, size_t count);
+        template <typename T> const T* section(size_t offset) const;
+        MappedFile file;
+        Header header;
+        Layout layout;
+};
+
+static_assert(sizeof(Connection) == 5 * sizeof(int32_t), "Connection must stay a packed record of five ints");
+static_assert(sizeof(TripPlusLayover) == 4 * sizeof(int32_t), "TripPlusLayover must stay a packed record of four ints");
+
+CompiledTimetable::CompiledTimetable(const std::string& path, bool verifyTables) : file(path, false)
+{
+    if (file.GetSize() < sizeof(Header))
+    {
+        throw std::runtime_error(path + ": not a compiled timetable (file too small)");
+    }
+
+    std::memcpy(&header, file.GetData(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw std::runtime_error(path + ": not a compiled timetable");
+    }
+    if (header.byteOrderMark != BYTE_ORDER_MARK)
+    {
+        throw std::runtime_error(path + ": compiled on a machine with a different byte order");
+    }
+    if (header.version != FORMAT_VERSION)
+    {
+        throw std::runtime_error(path + ": compiled timetable version " + std::to_string(header.version) +
+            ", expected " + std::to_string(FORMAT_VERSION));
+    }
+
+    layout = compute_layout(header);
+    if (layout.fileSize != file.GetSize())
+    {
+        throw std::runtime_error(path + ": compiled timetable is truncated or has trailing data");
+    }
+
+    if (checksum(CHECKSUM_SEED, file.GetData() + sizeof(Header), layout.withLayoverTable - sizeof(Header)) != header.dataChecksum)
+    {
+        throw std::runtime_error(path + ": compiled timetable checksum mismatch");
+    }
+    if (verifyTables && checksum(CHECKSUM_SEED, file.GetData() + layout.withLayoverTable, layout.fileSize - layout.withLayoverTable) != header.tableChecksum)
+    {
+        throw std::runtime_error(path + ": compiled timetable sequence table checksum mismatch");
+    }
+}
+
+void CompiledTimetable::Write(const std::string& path, const std::vector<StationRecord>& stations, const std::vector<Connection>& trips,
+    const DepartureGraph& departures, const SequenceTable& withLayoverTable, const SequenceTable& withoutLayoverTable)
+{
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.stationCount = stations.size();
+    header.tripCount = trips.size();
+    header.vertexCount = departures.GetVertexCount();
+    header.dataChecksum = CHECKSUM_SEED;
+    header.tableChecksum = CHECKSUM_SEED;
+
+    // Flatten the variable sized parts first so the layout is known before writing.
+    std::vector<int32_t> stationIDs;
+    std::vector<uint32_t> nameOffsets = {0};
+    std::string names;
+    for (const StationRecord& station : stations)
+    {
+        stationIDs.push_back(station.stationID);
+        names += station.name;
+        nameOffsets.push_back(names.size());
+    }
+    header.nameBytes = names.size();
+
+    std::vector<int32_t> vertexStations;
+    std::vector<int32_t> vertexTimes;
+    std::vector<uint32_t> edgeOffsets = {0};
+    std::vector<TripPlusLayover> edges;
+    for (int key = 0; key < departures.GetVertexCount(); key++)
+    {
+        vertexStations.push_back(departures.GetStationID(key));
+        vertexTimes.push_back(departures.GetDepartureTime(key));
+        for (size_t edge = departures.GetEdgeBegin(key); edge < departures.GetEdgeEnd(key); edge++)
+        {
+            edges.push_back(departures.GetEdge(edge));
+        }
+        edgeOffsets.push_back(edges.size());
+    }
+    header.edgeCount = edges.size();
+    Layout layout = compute_layout(header);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error(path + ": could not open file for writing");
+    }
+
+    // Writes one section at its offset, zero padding up to it, and folds the bytes into the running checksum.
+    size_t written = sizeof(Header);
+    uint64_t* runningChecksum = &header.dataChecksum;
+    auto writeSection = [&](size_t offset, const void* bytes, size_t count)
+    {
+        static const char padding[8] = {};
+        *runningChecksum = checksum(*runningChecksum, padding, offset - written);
+        out.write(padding, offset - written);
+        *runningChecksum = checksum(*runningChecksum, static_cast<const char*>(bytes), count);
+        out.write(static_cast<const char*>(bytes), count);
+        written = offset + count;
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    writeSection(layout.stationIDs, stationIDs.data(), stationIDs.size() * sizeof(int32_t));
+    writeSection(layout.nameOffsets, nameOffsets.data(), nameOffsets.size() * sizeof(uint32_t));
+    writeSection(layout.names, names.data(), names.size());
+    writeSection(layout.trips, trips.data(), trips.size() * sizeof(Connection));
+    writeSection(layout.vertexStations, vertexStations.data(), vertexStations.size() * sizeof(int32_t));
+    writeSection(layout.vertexTimes, vertexTimes.data(), vertexTimes.size() * sizeof(int32_t));
+    writeSection(layout.edgeOffsets, edgeOffsets.data(), edgeOffsets.size() * sizeof(uint32_t));
+    writeSection(layout.edges, edges.data(), edges.size() * sizeof(TripPlusLayover));
+
+    size_t tableBytes = (size_t)header.vertexCount * header.vertexCount * SequenceTable::GetEntryBytes(header.vertexCount);
+    // Padding before the tables still belongs to the data checksum.
+    writeSection(layout.withLayoverTable, nullptr, 0);
+    runningChecksum = &header.tableChecksum;
+    writeSection(layout.withLayoverTable, withLayoverTable.GetData(), tableBytes);
+    writeSection(layout.withoutLayoverTable, withoutLayoverTable.GetData(), tableBytes);
+
+    // Checksums are only known now, rewrite the header.
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    if (!out)
+    {
+        throw std::runtime_error(path + ": failed writing compiled timetable");
+    }
+}
+
+void CompiledTimetable::ReadStations(std::vector<StationRecord>& stations) const
+{
+    const int32_t* stationIDs = section<int32_t>(layout.stationIDs);
+    const uint32_t* nameOffsets = section<uint32_t>(layout.nameOffsets);
+    const char* names = section<char>(layout.names);
+
+    for (uint32_t i = 0; i < header.stationCount; i++)
+    {
+        stations.push_back({stationIDs[i], std::string(names + nameOffsets[i], names + nameOffsets[i + 1])});
+    }
+}
+
+void CompiledTimetable::ReadTrips(std::vector<Connection>& trips) const
+{
+    const Connection* compiledTrips = section<Connection>(layout.trips);
+    trips.assign(compiledTrips, compiledTrips + header.tripCount);
+}
+
+void CompiledTimetable::ReadDepartures(DepartureGraph& departures) const
+{
+    const int32_t* vertexStations = section<int32_t>(layout.vertexStations);
+    const int32_t* vertexTimes = section<int32_t>(layout.vertexTimes);
+    const uint32_t* edgeOffsets = section<uint32_t>(layout.edgeOffsets);
+    const TripPlusLayover* edges = section<TripPlusLayover>(layout.edges);
+
+    departures.Reserve(header.vertexCount, header.edgeCount);
+    for (uint32_t i = 0; i < header.vertexCount; i++)
+    {
+        departures.AddVertex(vertexStations[i], vertexTimes[i], edges + edgeOffsets[i], edgeOffsets[i + 1] - edgeOffsets[i]);
+    }
+}
+
+const void* CompiledTimetable::GetSequenceTableData(bool includeLayovers) const
+{
+    return section<char>(includeLayovers ? layout.withLayoverTable : layout.withoutLayoverTable);
+}
+
+int CompiledTimetable::GetVertexCount() const
+{
+    return header.vertexCount;
+}
+
+CompiledTimetable::Layout CompiledTimetable::compute_layout(const Header& header)
+{
+    auto align = [](size_t offset) { return (offset + 7) & ~(size_t)7; };
+    size_t tableBytes = (size_t)header.vertexCount * header.vertexCount * SequenceTable::GetEntryBytes(header.vertexCount);
+
+    Layout layout;
+    layout.stationIDs = align(sizeof(Header));
+    layout.nameOffsets = align(layout.stationIDs + (size_t)header.stationCount * sizeof(int32_t));
+    layout.names = align(layout.nameOffsets + ((size_t)header.stationCount + 1) * sizeof(uint32_t));
+    layout.trips = align(layout.names + header.nameBytes);
+    layout.vertexStations = align(layout.trips + (size_t)header.tripCount * sizeof(Connection));
+    layout.vertexTimes = align(layout.vertexStations + (size_t)header.vertexCount * sizeof(int32_t));
+    layout.edgeOffsets = align(layout.vertexTimes + (size_t)header.vertexCount * sizeof(int32_t));
+    layout.edges = align(layout.edgeOffsets + ((size_t)header.vertexCount + 1) * sizeof(uint32_t));
+    layout.withLayoverTable = align(layout.edges + (size_t)header.edgeCount * sizeof(TripPlusLayover));
+    layout.withoutLayoverTable = align(layout.withLayoverTable + tableBytes);
+    layout.fileSize = layout.withoutLayoverTable + tableBytes;
+    return layout;
+}
+
+// 64 bit FNV-1a, pass CHECKSUM_SEED to start a new checksum.
+uint64_t CompiledTimetable::checksum(uint64_t hash, const char* bytes, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        hash ^= (unsigned char)bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+template <typename T>
+const T* CompiledTimetable::section(size_t offset) const
+{
+    return reinterpret_cast<const T*>(file.GetData() + offset);
+}
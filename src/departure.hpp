@@ -1,7 +1,8 @@
 #pragma once
-#include <vector>
 #include "trip.hpp"
 
+// Read-only view of one departure graph vertex and its edges. It points into the graph's edge arrays instead of holding a copy,
+// so it is only valid until a runtime update changes the graph. The key, station and time are kept by value.
 class Departure {
     public:
         int GetStationID() const;
@@ -11,20 +12,30 @@ class Departure {
         bool IsFinalDestination() const;
         TripPlusLayover GetTrip(int tripIndex) const;
         TripPlusLayover FindTripByDestinationKey(int destinationKey) const;
-        Departure(std::vector<TripPlusLayover> tripArray, int ID, int key, int departure);
+        Departure(int ID, int key, int departure, const int* destinationKeyArray, const int* rideMinuteArray, const int* layoverMinuteArray,
+            const int* weightArray, int count);
     private:
-        std::vector<TripPlusLayover> validTrips;
+        const int* destinationKeys;
+        const int* rideMinutes;
+        const int* layoverMinutes;
+        const int* weights;
+        int tripCount;
         int lookUpKey;
         int stationID;
         int departureTime;
 };
 
-Departure::Departure(std::vector<TripPlusLayover> tripArray, int ID, int key, int departure)
+Departure::Departure(int ID, int key, int departure, const int* destinationKeyArray, const int* rideMinuteArray, const int* layoverMinuteArray,
+    const int* weightArray, int count)
 {
-    validTrips = tripArray;
     stationID = ID;
     lookUpKey = key;
     departureTime = departure;
+    destinationKeys = destinationKeyArray;
+    rideMinutes = rideMinuteArray;
+    layoverMinutes = layoverMinuteArray;
+    weights = weightArray;
+    tripCount = count;
 }
 
 int Departure::GetDepartureTime() const
@@ -34,7 +45,7 @@ int Departure::GetDepartureTime() const
 
 bool Departure::IsFinalDestination() const
 {
-    return validTrips.size() == 0;
+    return tripCount == 0;
 }
 
 int Departure::GetLookUpKey() const
@@ -44,11 +55,11 @@ int Departure::GetLookUpKey() const
 
 TripPlusLayover Departure::FindTripByDestinationKey(int destinationKey) const
 {
-    for(TripPlusLayover trip : validTrips)
+    for(int i = 0; i < tripCount; i++)
     {
-        if(trip.destinationKey == destinationKey)
+        if(destinationKeys[i] == destinationKey)
         {
-            return trip;
+            return GetTrip(i);
         }
     }
 
@@ -57,12 +68,12 @@ TripPlusLayover Departure::FindTripByDestinationKey(int destinationKey) const
 
 TripPlusLayover Departure::GetTrip(int tripIndex) const
 {
-    return validTrips[tripIndex];
+    return {destinationKeys[tripIndex], rideMinutes[tripIndex], layoverMinutes[tripIndex], weights[tripIndex]};
 }
 
 int Departure::GetTripCount() const
 {
-    return validTrips.size();
+    return tripCount;
 }
 
 int Departure::GetStationID() const
@@ -0,0 +1,256 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <memory_resource>
+#include "trip.hpp"
+#include "departure.hpp"
+#include "graph_arena.hpp"
+
+// The departure graph in compressed sparse row form. Vertex key's edges are edge indexes edgeOffsets[key] up to
+// edgeOffsets[key + 1], and each field of an edge has its own array, so a walk over the edges of a vertex reads a few
+// contiguous runs of ints instead of a separate heap block per vertex. Vertices are added in key order while building.
+// The arrays share one GraphArena block sized by Reserve. Runtime updates replace edge lists or insert a vertex in one pass over
+// the arrays, the graph is rebuilt around them into a fresh arena and the old one is released whole.
+class DepartureGraph {
+    public:
+        int GetVertexCount() const;
+        size_t GetEdgeCount() const;
+        int GetStationID(int key) const;
+        int GetDepartureTime(int key) const;
+        // True for vertices without edges, the terminal vertices and cancelled trips.
+        bool IsFinalDestination(int key) const;
+        size_t GetEdgeBegin(int key) const;
+        size_t GetEdgeEnd(int key) const;
+        int GetDestinationKey(size_t edge) const;
+        int GetRideMinutes(size_t edge) const;
+        int GetLayoverMinutes(size_t edge) const;
+        // Ride plus layover minutes.
+        int GetWeight(size_t edge) const;
+        TripPlusLayover GetEdge(size_t edge) const;
+        // First edge of key into destinationKey, or {-1} if there is none.
+        TripPlusLayover FindEdge(int key, int destinationKey) const;
+        // View of vertex key and its edges, valid until the graph changes.
+        Departure GetDeparture(int key) const;
+        // Starts the graph over with one arena block holding arrays sized for vertexCount vertices and edgeCount edges, so building
+        // it doesn't reallocate or leave slack.
+        void Reserve(int vertexCount, size_t edgeCount);
+        void AddVertex(int stationID, int departureTime, const TripPlusLayover* edges, int edgeCount);
+        // Moves vertex key to another station or departure time, its edges stay as they are.
+        void SetVertex(int key, int stationID, int departureTime);
+        // Gives each vertex in keys, ascending, the matching list of edgeLists.
+        void ReplaceEdges(const std::vector<int>& keys, const std::vector<std::vector<TripPlusLayover>>& edgeLists);
+        // Adds a vertex without edges at key, vertices from key on and every edge into them move up by one key.
+        void InsertVertex(int key, int stationID, int departureTime);
+        size_t GetBytes() const;
+        DepartureGraph();
+    private:
+        // The graph's arrays and the arena they are carved from, replaced together by Reserve.
+        struct Arrays {
+            GraphArena arena;
+            std::pmr::vector<int> stationIDs{&arena};
+            std::pmr::vector<int> departureTimes{&arena};
+            std::pmr::vector<size_t> edgeOffsets{&arena};
+            std::pmr::vector<int> destinationKeys{&arena};
+            std::pmr::vector<int> rideMinutes{&arena};
+            std::pmr::vector<int> layoverMinutes{&arena};
+            std::pmr::vector<int> weights{&arena};
+            Arrays(size_t bytes) : arena(bytes) {}
+        };
+        std::unique_ptr<Arrays> arrays;
+        void push_edge(const TripPlusLayover& edge);
+        void copy_vertex(const Arrays& source, int key, int keyShift, int shiftFromKey);
+};
+
+DepartureGraph::DepartureGraph()
+{
+    Reserve(0, 0);
+}
+
+int DepartureGraph::GetVertexCount() const
+{
+    return arrays->stationIDs.size();
+}
+
+size_t DepartureGraph::GetEdgeCount() const
+{
+    return arrays->destinationKeys.size();
+}
+
+int DepartureGraph::GetStationID(int key) const
+{
+    return arrays->stationIDs[key];
+}
+
+int DepartureGraph::GetDepartureTime(int key) const
+{
+    return arrays->departureTimes[key];
+}
+
+bool DepartureGraph::IsFinalDestination(int key) const
+{
+    return arrays->edgeOffsets[key] == arrays->edgeOffsets[key + 1];
+}
+
+size_t DepartureGraph::GetEdgeBegin(int key) const
+{
+    return arrays->edgeOffsets[key];
+}
+
+size_t DepartureGraph::GetEdgeEnd(int key) const
+{
+    return arrays->edgeOffsets[key + 1];
+}
+
+int DepartureGraph::GetDestinationKey(size_t edge) const
+{
+    return arrays->destinationKeys[edge];
+}
+
+int DepartureGraph::GetRideMinutes(size_t edge) const
+{
+    return arrays->rideMinutes[edge];
+}
+
+int DepartureGraph::GetLayoverMinutes(size_t edge) const
+{
+    return arrays->layoverMinutes[edge];
+}
+
+int DepartureGraph::GetWeight(size_t edge) const
+{
+    return arrays->weights[edge];
+}
+
+TripPlusLayover DepartureGraph::GetEdge(size_t edge) const
+{
+    return {arrays->destinationKeys[edge], arrays->rideMinutes[edge], arrays->layoverMinutes[edge], arrays->weights[edge]};
+}
+
+TripPlusLayover DepartureGraph::FindEdge(int key, int destinationKey) const
+{
+    for (size_t edge = arrays->edgeOffsets[key]; edge < arrays->edgeOffsets[key + 1]; edge++)
+    {
+        if (arrays->destinationKeys[edge] == destinationKey)
+        {
+            return GetEdge(edge);
+        }
+    }
+
+    return {-1};
+}
+
+Departure DepartureGraph::GetDeparture(int key) const
+{
+    const Arrays& graph = *arrays;
+    size_t edge = graph.edgeOffsets[key];
+    return {graph.stationIDs[key], key, graph.departureTimes[key], graph.destinationKeys.data() + edge, graph.rideMinutes.data() + edge,
+        graph.layoverMinutes.data() + edge, graph.weights.data() + edge, (int)(graph.edgeOffsets[key + 1] - edge)};
+}
+
+void DepartureGraph::push_edge(const TripPlusLayover& edge)
+{
+    arrays->destinationKeys.push_back(edge.destinationKey);
+    arrays->rideMinutes.push_back(edge.rideTimeToDestinationMins);
+    arrays->layoverMinutes.push_back(edge.layoverAtDestinationMins);
+    arrays->weights.push_back(edge.tripWeight);
+}
+
+void DepartureGraph::Reserve(int vertexCount, size_t edgeCount)
+{
+    // Room for the seven arrays plus the padding that aligns each of them.
+    size_t bytes = (size_t)vertexCount * 2 * sizeof(int) + ((size_t)vertexCount + 1) * sizeof(size_t) + edgeCount * 4 * sizeof(int) +
+        7 * alignof(std::max_align_t);
+    arrays.reset(new Arrays(bytes));
+    arrays->stationIDs.reserve(vertexCount);
+    arrays->departureTimes.reserve(vertexCount);
+    arrays->edgeOffsets.reserve(vertexCount + 1);
+    arrays->destinationKeys.reserve(edgeCount);
+    arrays->rideMinutes.reserve(edgeCount);
+    arrays->layoverMinutes.reserve(edgeCount);
+    arrays->weights.reserve(edgeCount);
+    arrays->edgeOffsets.push_back(0);
+}
+
+void DepartureGraph::AddVertex(int stationID, int departureTime, const TripPlusLayover* edges, int edgeCount)
+{
+    arrays->stationIDs.push_back(stationID);
+    arrays->departureTimes.push_back(departureTime);
+    for (int i = 0; i < edgeCount; i++)
+    {
+        push_edge(edges[i]);
+    }
+    arrays->edgeOffsets.push_back(arrays->destinationKeys.size());
+}
+
+// Appends vertex key of source with its edges, destination keys from shiftFromKey on move up by keyShift.
+void DepartureGraph::copy_vertex(const Arrays& source, int key, int keyShift, int shiftFromKey)
+{
+    arrays->stationIDs.push_back(source.stationIDs[key]);
+    arrays->departureTimes.push_back(source.departureTimes[key]);
+    for (size_t edge = source.edgeOffsets[key]; edge < source.edgeOffsets[key + 1]; edge++)
+    {
+        int destinationKey = source.destinationKeys[edge];
+        arrays->destinationKeys.push_back(destinationKey >= shiftFromKey ? destinationKey + keyShift : destinationKey);
+        arrays->rideMinutes.push_back(source.rideMinutes[edge]);
+        arrays->layoverMinutes.push_back(source.layoverMinutes[edge]);
+        arrays->weights.push_back(source.weights[edge]);
+    }
+    arrays->edgeOffsets.push_back(arrays->destinationKeys.size());
+}
+
+void DepartureGraph::SetVertex(int key, int stationID, int departureTime)
+{
+    arrays->stationIDs[key] = stationID;
+    arrays->departureTimes[key] = departureTime;
+}
+
+void DepartureGraph::ReplaceEdges(const std::vector<int>& keys, const std::vector<std::vector<TripPlusLayover>>& edgeLists)
+{
+    std::unique_ptr<Arrays> replaced = std::move(arrays);
+    int vertexCount = replaced->stationIDs.size();
+    size_t edgeCount = replaced->destinationKeys.size();
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        edgeCount += edgeLists[i].size() - (replaced->edgeOffsets[keys[i] + 1] - replaced->edgeOffsets[keys[i]]);
+    }
+    Reserve(vertexCount, edgeCount);
+
+    size_t next = 0;
+    for (int key = 0; key < vertexCount; key++)
+    {
+        if (next < keys.size() && keys[next] == key)
+        {
+            AddVertex(replaced->stationIDs[key], replaced->departureTimes[key], edgeLists[next].data(), edgeLists[next].size());
+            next++;
+        }
+        else
+        {
+            copy_vertex(*replaced, key, 0, vertexCount);
+        }
+    }
+}
+
+void DepartureGraph::InsertVertex(int key, int stationID, int departureTime)
+{
+    std::unique_ptr<Arrays> replaced = std::move(arrays);
+    int vertexCount = replaced->stationIDs.size();
+    Reserve(vertexCount + 1, replaced->destinationKeys.size());
+
+    for (int i = 0; i <= vertexCount; i++)
+    {
+        if (i == key)
+        {
+            AddVertex(stationID, departureTime, nullptr, 0);
+        }
+        if (i < vertexCount)
+        {
+            copy_vertex(*replaced, i, 1, key);
+        }
+    }
+}
+
+size_t DepartureGraph::GetBytes() const
+{
+    return sizeof(DepartureGraph) + sizeof(Arrays) + arrays->arena.GetReservedBytes();
+}
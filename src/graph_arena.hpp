@@ -0,0 +1,80 @@
+#pragma once
+#include <new>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+
+// Monotonic storage for the arrays of the departure, station and arrival graphs. Arrays are carved one after the other out of
+// blocks, the first one sized by the owner to hold every array it reserves, so a graph built in one go is a single heap block.
+// Nothing is freed until the arena is destroyed, the graphs build the result of a runtime update into a fresh arena and drop the
+// old one whole rather than growing arrays in place. Not thread safe, only used while a graph is built or held exclusively.
+class GraphArena : public std::pmr::memory_resource {
+    public:
+        // Bytes taken from the heap for blocks, used or not.
+        size_t GetReservedBytes() const;
+        GraphArena(size_t firstBlockBytes);
+        ~GraphArena();
+        GraphArena(const GraphArena&) = delete;
+        GraphArena& operator=(const GraphArena&) = delete;
+    private:
+        static constexpr size_t MIN_BLOCK_BYTES = 256;
+        static constexpr size_t MAX_BLOCK_BYTES = (size_t)16 << 20;
+        std::vector<void*> blocks;
+        char* blockPosition = nullptr;
+        size_t blockRemaining = 0;
+        size_t nextBlockBytes;
+        size_t reservedBytes = 0;
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* memory, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+GraphArena::GraphArena(size_t firstBlockBytes) : nextBlockBytes(std::max(firstBlockBytes, MIN_BLOCK_BYTES))
+{
+}
+
+GraphArena::~GraphArena()
+{
+    for (void* block : blocks)
+    {
+        ::operator delete(block);
+    }
+}
+
+void* GraphArena::do_allocate(size_t bytes, size_t alignment)
+{
+    size_t padding = (alignment - (uintptr_t)blockPosition % alignment) % alignment;
+    if (padding + bytes > blockRemaining)
+    {
+        // An array larger than the next block gets a block of its own size, the rest of the current block is given up.
+        size_t blockBytes = std::max(nextBlockBytes, bytes + alignment);
+        blocks.push_back(::operator new(blockBytes));
+        blockPosition = static_cast<char*>(blocks.back());
+        blockRemaining = blockBytes;
+        reservedBytes += blockBytes;
+        nextBlockBytes = std::max(MIN_BLOCK_BYTES, std::min(nextBlockBytes * 2, MAX_BLOCK_BYTES));
+        padding = (alignment - (uintptr_t)blockPosition % alignment) % alignment;
+    }
+
+    void* memory = blockPosition + padding;
+    blockPosition += padding + bytes;
+    blockRemaining -= padding + bytes;
+    return memory;
+}
+
+void GraphArena::do_deallocate(void* memory, size_t bytes, size_t alignment)
+{
+    // Released all at once with the arena.
+}
+
+bool GraphArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+size_t GraphArena::GetReservedBytes() const
+{
+    return reservedBytes;
+}
@@ -0,0 +1,148 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include "local_socket.hpp"
+
+// Load generator for the query server. Every client thread opens its own connection and sends the queries from the file,
+// starting at a different offset, waiting for each result before sending the next one. Reports throughput and latency.
+
+struct ClientResult {
+    std::vector<double> latenciesMicros;
+    int errors = 0;
+    bool failed = false;
+};
+
+static void run_client(const std::string& address, const std::vector<std::string>& queries, int startIndex, int queryCount,
+    ClientResult& result)
+{
+    int socketFd = -1;
+    try
+    {
+        socketFd = LocalSocket::Connect(address);
+    }
+    catch (const std::runtime_error& error)
+    {
+        std::cerr << error.what() << std::endl;
+        result.failed = true;
+        return;
+    }
+
+    // Results of window queries on large timetables can run long, the limit only guards against a broken server.
+    SocketLineReader reader(socketFd, (size_t)64 << 20);
+    std::string request;
+    std::string response;
+    result.latenciesMicros.reserve(queryCount);
+    for (int i = 0; i < queryCount; i++)
+    {
+        request = queries[(startIndex + i) % queries.size()];
+        request.push_back('\n');
+
+        auto start = std::chrono::steady_clock::now();
+        if (!LocalSocket::WriteAll(socketFd, request.data(), request.size()) || !reader.ReadLine(response))
+        {
+            result.failed = true;
+            break;
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        result.latenciesMicros.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        if (response.compare(0, 5, "error") == 0)
+        {
+            result.errors++;
+        }
+    }
+    close(socketFd);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "useage: ./load_client.out <port|socket path> <queries> [--clients n] [--queries n]\n";
+        return 0;
+    }
+
+    std::string address = argv[1];
+    int clientCount = 1;
+    int totalQueries = 0;
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        if (flag == "--clients")
+        {
+            clientCount = std::max(1, std::atoi(argv[i + 1]));
+        }
+        else if (flag == "--queries")
+        {
+            totalQueries = std::max(0, std::atoi(argv[i + 1]));
+        }
+    }
+
+    std::vector<std::string> queries;
+    std::ifstream queryFile(argv[2]);
+    std::string line;
+    while (std::getline(queryFile, line))
+    {
+        if (line.find_first_not_of(" \t\r") != std::string::npos && line[line.find_first_not_of(" \t\r")] != '#')
+        {
+            queries.push_back(line);
+        }
+    }
+    if (queries.empty())
+    {
+        std::cout << "No queries in " << argv[2] << std::endl;
+        return 1;
+    }
+    // By default every query in the file is sent once.
+    if (totalQueries == 0)
+    {
+        totalQueries = queries.size();
+    }
+
+    std::vector<ClientResult> results(clientCount);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < clientCount; i++)
+    {
+        int queryCount = totalQueries / clientCount + (i < totalQueries % clientCount ? 1 : 0);
+        int startIndex = (long long)i * queries.size() / clientCount;
+        clients.emplace_back(run_client, std::cref(address), std::cref(queries), startIndex, queryCount, std::ref(results[i]));
+    }
+    for (std::thread& client : clients)
+    {
+        client.join();
+    }
+    double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> latencies;
+    int errors = 0;
+    bool failed = false;
+    for (ClientResult& result : results)
+    {
+        latencies.insert(latencies.end(), result.latenciesMicros.begin(), result.latenciesMicros.end());
+        errors += result.errors;
+        failed = failed || result.failed;
+    }
+    if (latencies.empty())
+    {
+        std::cout << "No queries were answered" << std::endl;
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) { return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "queries " << latencies.size() << " clients " << clientCount << " errors " << errors << "\n"
+              << "seconds " << std::setprecision(3) << elapsedSeconds << " throughput " << std::setprecision(0)
+              << latencies.size() / elapsedSeconds << " queries/s\n" << std::setprecision(1)
+              << "latency us p50 " << percentile(0.50) << " p90 " << percentile(0.90) << " p99 " << percentile(0.99)
+              << " max " << latencies.back() << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,305 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Device and inode of the socket file a listening UNIX socket created, zero for TCP ports.
+struct SocketFileID {
+    dev_t device = 0;
+    ino_t inode = 0;
+};
+
+// Opens the sockets the query server and its clients talk over. An address made only of digits is a TCP port on 127.0.0.1,
+// anything else is the path of a UNIX domain socket. Failures throw std::runtime_error.
+class LocalSocket {
+    public:
+        // A file already at a UNIX socket path is only replaced if it is a socket nobody is listening on, anything else makes
+        // Listen fail. socketFile is set to the file it creates.
+        static int Listen(const std::string& address, SocketFileID& socketFile);
+        // Closes the listening socket and removes its socket file, unless the path now holds a file this process didn't create.
+        static void StopListening(int listenFd, const std::string& address, const SocketFileID& socketFile);
+        static int Connect(const std::string& address);
+        static bool IsTcpPort(const std::string& address);
+        // Writes the whole buffer, false if the other side went away.
+        static bool WriteAll(int socketFd, const char* data, size_t size);
+    private:
+        static void fill_unix_address(const std::string& path, sockaddr_un& unixAddress);
+        static void remove_stale_socket(const std::string& path, const sockaddr_un& unixAddress);
+        static void fill_tcp_address(const std::string& port, sockaddr_in& tcpAddress);
+        static void throw_error(const std::string& address, const std::string& message);
+};
+
+// Reads newline terminated requests or responses from a socket through a buffer, so a line costs one read call at most.
+// A line longer than maxLineBytes ends the stream, so a peer that never sends a line break can't grow the buffer without limit.
+class SocketLineReader {
+    public:
+        SocketLineReader(int fd, size_t maxLineBytes);
+        // Reads the next line without its line break, false once the stream is closed or a line is too long.
+        bool ReadLine(std::string& line);
+        // Whether a complete line is already buffered, the next ReadLine won't block.
+        bool HasBufferedLine() const;
+        // Whether the last ReadLine failed on a line longer than maxLineBytes.
+        bool LineTooLong() const;
+    private:
+        int socketFd;
+        const size_t lineLimit;
+        std::string buffer;
+        size_t position = 0;
+        bool lineTooLong = false;
+};
+
+bool LocalSocket::IsTcpPort(const std::string& address)
+{
+    return !address.empty() && address.find_first_not_of("0123456789") == std::string::npos;
+}
+
+int LocalSocket::Listen(const std::string& address, SocketFileID& socketFile)
+{
+    socketFile = SocketFileID();
+    int socketFd = -1;
+    if (IsTcpPort(address))
+    {
+        sockaddr_in tcpAddress;
+        fill_tcp_address(address, tcpAddress);
+        socketFd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (socketFd < 0 || bind(socketFd, (sockaddr*)&tcpAddress, sizeof(tcpAddress)) != 0)
+        {
+            if (socketFd >= 0) close(socketFd);
+            throw_error(address, "could not bind");
+        }
+    }
+    else
+    {
+        sockaddr_un unixAddress;
+        fill_unix_address(address, unixAddress);
+        // A socket file left by a server that didn't exit cleanly would make bind fail.
+        remove_stale_socket(address, unixAddress);
+        socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socketFd < 0 || bind(socketFd, (sockaddr*)&unixAddress, sizeof(unixAddress)) != 0)
+        {
+            if (socketFd >= 0) close(socketFd);
+            throw_error(address, "could not bind");
+        }
+
+        struct stat fileInfo;
+        if (lstat(address.c_str(), &fileInfo) == 0)
+        {
+            socketFile.device = fileInfo.st_dev;
+            socketFile.inode = fileInfo.st_ino;
+        }
+    }
+
+    if (listen(socketFd, SOMAXCONN) != 0)
+    {
+        close(socketFd);
+        throw_error(address, "could not listen");
+    }
+    return socketFd;
+}
+
+void LocalSocket::StopListening(int listenFd, const std::string& address, const SocketFileID& socketFile)
+{
+    close(listenFd);
+    if (IsTcpPort(address) || socketFile.inode == 0)
+    {
+        return;
+    }
+
+    struct stat fileInfo;
+    if (lstat(address.c_str(), &fileInfo) == 0 && S_ISSOCK(fileInfo.st_mode) &&
+        fileInfo.st_dev == socketFile.device && fileInfo.st_ino == socketFile.inode)
+    {
+        unlink(address.c_str());
+    }
+}
+
+int LocalSocket::Connect(const std::string& address)
+{
+    int socketFd = -1;
+    int connected = -1;
+    if (IsTcpPort(address))
+    {
+        sockaddr_in tcpAddress;
+        fill_tcp_address(address, tcpAddress);
+        socketFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (socketFd >= 0)
+        {
+            // Requests are single small lines, don't let Nagle hold them back.
+            int noDelay = 1;
+            setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            connected = connect(socketFd, (sockaddr*)&tcpAddress, sizeof(tcpAddress));
+        }
+    }
+    else
+    {
+        sockaddr_un unixAddress;
+        fill_unix_address(address, unixAddress);
+        socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socketFd >= 0)
+        {
+            connected = connect(socketFd, (sockaddr*)&unixAddress, sizeof(unixAddress));
+        }
+    }
+
+    if (connected != 0)
+    {
+        if (socketFd >= 0) close(socketFd);
+        throw_error(address, "could not connect");
+    }
+    return socketFd;
+}
+
+bool LocalSocket::WriteAll(int socketFd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = send(socketFd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+void LocalSocket::fill_unix_address(const std::string& path, sockaddr_un& unixAddress)
+{
+    std::memset(&unixAddress, 0, sizeof(unixAddress));
+    unixAddress.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(unixAddress.sun_path))
+    {
+        errno = 0;
+        throw_error(path, "socket path is too long");
+    }
+    std::memcpy(unixAddress.sun_path, path.c_str(), path.size() + 1);
+}
+
+// Nothing at the path is fine. A socket is only removed if connecting to it is refused, a server still accepting on it keeps it.
+void LocalSocket::remove_stale_socket(const std::string& path, const sockaddr_un& unixAddress)
+{
+    struct stat fileInfo;
+    if (lstat(path.c_str(), &fileInfo) != 0)
+    {
+        if (errno == ENOENT)
+        {
+            return;
+        }
+        throw_error(path, "could not check the socket path");
+    }
+    if (!S_ISSOCK(fileInfo.st_mode))
+    {
+        errno = 0;
+        throw_error(path, "a file that is not a socket is in the way, not replacing it");
+    }
+
+    int probeFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probeFd < 0)
+    {
+        throw_error(path, "could not check the socket");
+    }
+    int connected = connect(probeFd, (sockaddr*)&unixAddress, sizeof(unixAddress));
+    int connectError = errno;
+    close(probeFd);
+    if (connected == 0)
+    {
+        errno = 0;
+        throw_error(path, "another server is listening on this socket");
+    }
+    if (connectError != ECONNREFUSED)
+    {
+        errno = connectError;
+        throw_error(path, "could not check the socket");
+    }
+
+    if (unlink(path.c_str()) != 0 && errno != ENOENT)
+    {
+        throw_error(path, "could not remove the stale socket");
+    }
+}
+
+void LocalSocket::fill_tcp_address(const std::string& port, sockaddr_in& tcpAddress)
+{
+    int portNumber = std::atoi(port.c_str());
+    if (portNumber <= 0 || portNumber > 65535)
+    {
+        errno = 0;
+        throw_error(port, "invalid port");
+    }
+    std::memset(&tcpAddress, 0, sizeof(tcpAddress));
+    tcpAddress.sin_family = AF_INET;
+    tcpAddress.sin_port = htons(portNumber);
+    // Only local clients, the server is never exposed beyond the host.
+    tcpAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+void LocalSocket::throw_error(const std::string& address, const std::string& message)
+{
+    throw std::runtime_error(address + ": " + message + (errno ? std::string(" (") + std::strerror(errno) + ")" : ""));
+}
+
+SocketLineReader::SocketLineReader(int fd, size_t maxLineBytes) : lineLimit(maxLineBytes)
+{
+    socketFd = fd;
+}
+
+bool SocketLineReader::ReadLine(std::string& line)
+{
+    while (true)
+    {
+        size_t end = buffer.find('\n', position);
+        if (end != std::string::npos)
+        {
+            line.assign(buffer, position, end - position);
+            position = end + 1;
+            return true;
+        }
+
+        // Drop the consumed part before reading more so the buffer doesn't grow with the connection.
+        buffer.erase(0, position);
+        position = 0;
+        if (buffer.size() > lineLimit)
+        {
+            lineTooLong = true;
+            return false;
+        }
+
+        char chunk[4096];
+        ssize_t received = recv(socketFd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return false;
+        }
+        buffer.append(chunk, received);
+    }
+}
+
+bool SocketLineReader::HasBufferedLine() const
+{
+    return buffer.find('\n', position) != std::string::npos;
+}
+
+bool SocketLineReader::LineTooLong() const
+{
+    return lineTooLong;
+}
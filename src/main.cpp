@@ -1,35 +1,244 @@
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <cstddef>
+#include <fstream>
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
 #include "utility.hpp"
 #include "schedule.hpp"
 
 int main(int argc, char** argv)
 {
-    std::ifstream stationFile;
-    std::stringstream stationData;
-    std::ifstream trainFile;
-    std::stringstream trainData;
+    RouteEngine engine = RouteEngine::FloydWarshall;
+    int precomputeThreads = 1;
+    size_t treeCacheBytes = StationGraph::DEFAULT_TREE_CACHE_BYTES;
+    size_t routeCacheEntries = 0;
+    std::string compileOutputPath;
+    std::string compiledTimetablePath;
+    bool verifyTables = false;
+    bool showStats = false;
+    std::string statsJsonPath;
+    std::string batchPath;
+    std::string serveAddress;
+    int serverWorkers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> dataFiles;
+    bool validArgs = true;
 
-    if(argc != 3)
+    // Data files and flags can come in any order.
+    for(int i = 1; i < argc && validArgs; i++)
+    {
+        std::string flag = argv[i];
+        if(flag == "--engine" && i + 1 < argc)
+        {
+            std::string engineName = argv[++i];
+            if(engineName == "fw")
+            {
+                engine = RouteEngine::FloydWarshall;
+            }
+            else if(engineName == "csa")
+            {
+                engine = RouteEngine::ConnectionScan;
+            }
+            else if(engineName == "dijkstra")
+            {
+                engine = RouteEngine::Dijkstra;
+            }
+            else if(engineName == "lazy")
+            {
+                engine = RouteEngine::LazyTrees;
+            }
+            else if(engineName == "tp")
+            {
+                engine = RouteEngine::TransferPatterns;
+            }
+            else
+            {
+                validArgs = false;
+            }
+        }
+        else if(flag == "--threads" && i + 1 < argc)
+        {
+            // 0 uses every core on the machine.
+            precomputeThreads = atoi(argv[++i]);
+            if(precomputeThreads == 0)
+            {
+                precomputeThreads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            validArgs = precomputeThreads > 0;
+        }
+        else if(flag == "--tree-cache" && i + 1 < argc)
+        {
+            // Budget for the lazy engine's shortest path trees, in megabytes.
+            int treeCacheMegabytes = atoi(argv[++i]);
+            treeCacheBytes = (size_t)treeCacheMegabytes << 20;
+            validArgs = treeCacheMegabytes > 0;
+        }
+        else if(flag == "--route-cache" && i + 1 < argc)
+        {
+            // Number of route results kept, any engine.
+            int entries = atoi(argv[++i]);
+            routeCacheEntries = entries;
+            validArgs = entries > 0;
+        }
+        else if(flag == "--compile" && i + 1 < argc)
+        {
+            compileOutputPath = argv[++i];
+        }
+        else if(flag == "--timetable" && i + 1 < argc)
+        {
+            compiledTimetablePath = argv[++i];
+        }
+        else if(flag == "--batch" && i + 1 < argc)
+        {
+            batchPath = argv[++i];
+        }
+        else if(flag == "--serve" && i + 1 < argc)
+        {
+            serveAddress = argv[++i];
+        }
+        else if(flag == "--workers" && i + 1 < argc)
+        {
+            serverWorkers = atoi(argv[++i]);
+            validArgs = serverWorkers > 0;
+        }
+        else if(flag == "--verify")
+        {
+            verifyTables = true;
+        }
+        else if(flag == "--stats")
+        {
+            showStats = true;
+        }
+        else if(flag == "--stats-json" && i + 1 < argc)
+        {
+            statsJsonPath = argv[++i];
+        }
+        else if(flag.compare(0, 2, "--") != 0)
+        {
+            dataFiles.push_back(flag);
+        }
+        else
+        {
+            validArgs = false;
+        }
+    }
+
+    // Either both data files or a compiled timetable, compiling needs the data files and the table building engine.
+    if(compiledTimetablePath.empty())
+    {
+        validArgs = validArgs && dataFiles.size() == 2;
+    }
+    else
     {
-        std::cout << "useage: ./sched.out <stations.dat> <trains.dat>\n";
+        validArgs = validArgs && dataFiles.empty() && compileOutputPath.empty();
+    }
+    validArgs = validArgs && (compileOutputPath.empty() || engine == RouteEngine::FloydWarshall);
+    // Only one of compiling, batch and serving per run.
+    validArgs = validArgs && (!compileOutputPath.empty() + !batchPath.empty() + !serveAddress.empty()) <= 1;
+
+    if(!validArgs)
+    {
+        std::cout << "useage: ./sched.out <stations.dat> <trains.dat> [--engine fw|csa|dijkstra|lazy|tp] [--tree-cache mb] [--route-cache n] [--threads n] [--batch <queries|->] [--stats] [--stats-json <file>]\n"
+                  << "        ./sched.out <stations.dat> <trains.dat> --serve <port|socket path> [--workers n] [--engine ...] [--threads n]\n"
+                  << "        ./sched.out <stations.dat> <trains.dat> --compile <timetable.bin> [--threads n]\n"
+                  << "        ./sched.out --timetable <timetable.bin> [--engine fw|csa|dijkstra|lazy|tp] [--tree-cache mb] [--route-cache n] [--verify] [--batch <queries|->] [--serve <port|socket path>] [--workers n] [--stats] [--stats-json <file>]\n";
         return 0;
     }
 
-    // Get file data into a string so schedule can be constructed
-    stationFile.open(argv[1]);
-    stationData << stationFile.rdbuf();
-    stationFile.close();
+    // Schedule reads the files directly, parse errors report the file, line and column.
+    Schedule* trainSchedule;
+    try
+    {
+        if(compiledTimetablePath.empty())
+        {
+            trainSchedule = new Schedule(dataFiles[0], dataFiles[1], engine, precomputeThreads, treeCacheBytes, routeCacheEntries);
+        }
+        else
+        {
+            trainSchedule = new Schedule(compiledTimetablePath, engine, verifyTables, treeCacheBytes, routeCacheEntries);
+        }
+
+        // The report goes to stderr so batch results on stdout stay machine readable.
+        if(showStats)
+        {
+            std::cerr << "Load profile\n";
+            trainSchedule->GetLoadProfile().WriteReport(std::cerr);
+            std::cerr << "Memory\n";
+            trainSchedule->GetMemoryReport().WriteReport(std::cerr);
+        }
+        if(!statsJsonPath.empty())
+        {
+            std::ofstream statsFile(statsJsonPath);
+            statsFile << "{\"profile\": ";
+            trainSchedule->GetLoadProfile().WriteJson(statsFile);
+            statsFile << ", \"memory\": ";
+            trainSchedule->GetMemoryReport().WriteJson(statsFile);
+            statsFile << "}\n";
+            if(!statsFile)
+            {
+                throw std::runtime_error(statsJsonPath + ": could not write stats");
+            }
+        }
+
+        if(!compileOutputPath.empty())
+        {
+            trainSchedule->WriteCompiled(compileOutputPath);
+            std::cout << "Compiled timetable written to " << compileOutputPath << std::endl;
+            delete trainSchedule;
+            return 0;
+        }
+    }
+    catch(const std::runtime_error& error)
+    {
+        std::cout << error.what() << std::endl;
+        return 1;
+    }
 
-    stationFile.open(argv[2]);
-    trainData << stationFile.rdbuf();
-    trainFile.close();
+    // Server mode answers the batch queries over a local socket until stopped.
+    if(!serveAddress.empty())
+    {
+        int status = 0;
+        try
+        {
+            trainSchedule->Serve(serveAddress, serverWorkers);
+        }
+        catch(const std::runtime_error& error)
+        {
+            std::cout << error.what() << std::endl;
+            status = 1;
+        }
+        delete trainSchedule;
+        return status;
+    }
 
-    Schedule trainSchedule(stationData.str() , trainData.str());
+    // Batch mode answers queries from a file, or stdin for -, and skips the menu entirely.
+    if(!batchPath.empty())
+    {
+        std::ios::sync_with_stdio(false);
+        int status = 0;
+        if(batchPath == "-")
+        {
+            trainSchedule->RunBatch(std::cin, std::cout);
+        }
+        else
+        {
+            std::ifstream queries(batchPath);
+            if(queries)
+            {
+                trainSchedule->RunBatch(queries, std::cout);
+            }
+            else
+            {
+                std::cerr << "Could not open query file " << batchPath << std::endl;
+                status = 1;
+            }
+        }
+        delete trainSchedule;
+        return status;
+    }
 
     Utility::PrintMainMenu();
 
@@ -49,31 +258,40 @@ int main(int argc, char** argv)
         switch (choice)
         {
             case 1:
-                trainSchedule.PrintCompleteSchedule();
+                trainSchedule->PrintCompleteSchedule();
                 break;
             case 2:
-                trainSchedule.PrintStationSchedule();
+                trainSchedule->PrintStationSchedule();
                 break;
             case 3:
-                trainSchedule.LookUpStationId();
+                trainSchedule->LookUpStationId();
                 break;
             case 4:
-                trainSchedule.LookUpStationName();
+                trainSchedule->LookUpStationName();
                 break;
             case 5:
-                trainSchedule.GetRoute();
+                trainSchedule->GetRoute();
                 break;
             case 6:
-                trainSchedule.GetDirectRoute();
+                trainSchedule->GetDirectRoute();
                 break;
             case 7:
-                trainSchedule.ShortestTripLengthRideTime();
+                trainSchedule->ShortestTripLengthRideTime();
                 break;
             case 8:
-                trainSchedule.ShortestTripLengthWithLayover();
+                trainSchedule->ShortestTripLengthWithLayover();
                 break;
             case 9:
-                trainSchedule.ShortestTripDepartureTime();
+                trainSchedule->ShortestTripDepartureTime();
+                break;
+            case 10:
+                trainSchedule->ShortestTripsByTransfers();
+                break;
+            case 11:
+                trainSchedule->TripsInDepartureWindow();
+                break;
+            case 12:
+                trainSchedule->PrintDepartureBoard();
                 break;
             case 0:
                 quit = true;
@@ -81,9 +299,10 @@ int main(int argc, char** argv)
                 break;
             default:
                 Utility::PrintMainMenu();
-                std::cout <<"Invalid choice (enter number 0-9).\n";
+                std::cout <<"Invalid choice (enter number 0-12).\n";
                 break;    
         }
     }
 
+    delete trainSchedule;
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+#include <iomanip>
+#include <sys/resource.h>
+#include "allocation_counter.hpp"
+
+// Heap bytes held by the named structures of a loaded schedule, and named process counts (peak resident set, allocations) that are
+// not part of the total. Used by --stats and the benchmark to see whether the tables or the graphs set the memory a timetable needs.
+class MemoryReport {
+    public:
+        void AddStructure(const std::string& name, size_t bytes);
+        void AddCount(const std::string& name, long long count);
+        // Appends the structures and counts of another report, the graph reports its own and the schedule adds them to its tables.
+        void Append(const MemoryReport& other);
+        const std::vector<std::pair<std::string, size_t>>& GetStructures() const;
+        const std::vector<std::pair<std::string, long long>>& GetCounts() const;
+        size_t GetTotalBytes() const;
+        // Writes {"bytes": {"<structure>": bytes, ...}, "total_bytes": bytes, "counts": {"<count>": value, ...}} without a line break.
+        void WriteJson(std::ostream& output) const;
+        // Writes one line per structure with its KiB and share of the total, then one line per count.
+        void WriteReport(std::ostream& output) const;
+        // Largest resident set of the process so far, in bytes.
+        static long long GetPeakResidentBytes();
+        // Bytes of the elements vector can hold without growing.
+        template<typename T>
+        static size_t GetVectorBytes(const std::vector<T>& vector);
+        // Bytes of the inner vectors of vectors, plus the outer one.
+        template<typename T>
+        static size_t GetNestedVectorBytes(const std::vector<std::vector<T>>& vectors);
+        // Bytes of a vector of objects that count their own bytes, sizeof included, with GetBytes.
+        template<typename T>
+        static size_t GetObjectVectorBytes(const std::vector<T>& vector);
+        // Characters held outside the string object, zero for short strings kept inline.
+        static size_t GetStringBytes(const std::string& text);
+    private:
+        std::vector<std::pair<std::string, size_t>> structures;
+        std::vector<std::pair<std::string, long long>> counts;
+};
+
+template<typename T>
+size_t MemoryReport::GetVectorBytes(const std::vector<T>& vector)
+{
+    return vector.capacity() * sizeof(T);
+}
+
+template<typename T>
+size_t MemoryReport::GetNestedVectorBytes(const std::vector<std::vector<T>>& vectors)
+{
+    size_t bytes = GetVectorBytes(vectors);
+    for (const std::vector<T>& inner : vectors)
+    {
+        bytes += GetVectorBytes(inner);
+    }
+    return bytes;
+}
+
+template<typename T>
+size_t MemoryReport::GetObjectVectorBytes(const std::vector<T>& vector)
+{
+    size_t bytes = (vector.capacity() - vector.size()) * sizeof(T);
+    for (const T& element : vector)
+    {
+        bytes += element.GetBytes();
+    }
+    return bytes;
+}
+
+size_t MemoryReport::GetStringBytes(const std::string& text)
+{
+    return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+}
+
+long long MemoryReport::GetPeakResidentBytes()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    // Linux reports kilobytes.
+    return (long long)usage.ru_maxrss * 1024;
+}
+
+void MemoryReport::AddStructure(const std::string& name, size_t bytes)
+{
+    structures.push_back({name, bytes});
+}
+
+void MemoryReport::AddCount(const std::string& name, long long count)
+{
+    counts.push_back({name, count});
+}
+
+void MemoryReport::Append(const MemoryReport& other)
+{
+    structures.insert(structures.end(), other.structures.begin(), other.structures.end());
+    counts.insert(counts.end(), other.counts.begin(), other.counts.end());
+}
+
+const std::vector<std::pair<std::string, size_t>>& MemoryReport::GetStructures() const
+{
+    return structures;
+}
+
+const std::vector<std::pair<std::string, long long>>& MemoryReport::GetCounts() const
+{
+    return counts;
+}
+
+size_t MemoryReport::GetTotalBytes() const
+{
+    size_t totalBytes = 0;
+    for (const std::pair<std::string, size_t>& structure : structures)
+    {
+        totalBytes += structure.second;
+    }
+    return totalBytes;
+}
+
+void MemoryReport::WriteJson(std::ostream& output) const
+{
+    output << "{\"bytes\": {";
+    for (int i = 0; i < structures.size(); i++)
+    {
+        output << (i > 0 ? ", \"" : "\"") << structures[i].first << "\": " << structures[i].second;
+    }
+    output << "}, \"total_bytes\": " << GetTotalBytes() << ", \"counts\": {";
+    for (int i = 0; i < counts.size(); i++)
+    {
+        output << (i > 0 ? ", \"" : "\"") << counts[i].first << "\": " << counts[i].second;
+    }
+    output << "}}";
+}
+
+void MemoryReport::WriteReport(std::ostream& output) const
+{
+    size_t totalBytes = GetTotalBytes();
+    std::ios::fmtflags previousFlags = output.flags();
+    output << std::fixed << std::setprecision(1);
+    for (const std::pair<std::string, size_t>& structure : structures)
+    {
+        output << std::left << std::setw(48) << structure.first << std::right << std::setw(12) << structure.second / 1024.0 << " KiB"
+               << std::setw(7) << (totalBytes > 0 ? structure.second * 100.0 / totalBytes : 0) << " %\n";
+    }
+    output << std::left << std::setw(48) << "total" << std::right << std::setw(12) << totalBytes / 1024.0 << " KiB\n";
+    for (const std::pair<std::string, long long>& count : counts)
+    {
+        output << std::left << std::setw(48) << count.first << std::right << std::setw(15) << count.second << '\n';
+    }
+    output.flags(previousFlags);
+}
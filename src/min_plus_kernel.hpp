@@ -0,0 +1,283 @@
+#pragma once
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <thread>
+#include "thread_barrier.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MIN_PLUS_KERNEL_X86
+#endif
+
+/*
+    Floyd-Warshall over a single row-major distance buffer. The INF sentinel is half of the int range so two of them can be added
+    without overflowing, which removes the per element INF branches and lets rows be relaxed with vector min/compare instructions.
+
+    Within one k step row k and column k never change (there are no negative cycles), so every (i, j) update of that step is independent.
+    Only rows that reach k and columns k reaches are touched. Dense rows are relaxed in column tiles so the tile of row k stays in cache
+    across all rows. The update order inside a step does not matter, so distances and next hops come out exactly as the plain triple loop
+    produces them, ties included. k steps are not blocked together since that would change which of two equal paths is kept.
+
+    For the same reason rows can be split between threads, each thread owns a contiguous block of rows and all threads meet at a barrier
+    after every k step. Results are the same for any thread count.
+*/
+
+class MinPlusKernel{
+    public:
+        // Distances at or above INF mean no path. Safe to add two of them together.
+        static constexpr int INF = std::numeric_limits<int>::max() / 2;
+        // How rows are relaxed. Best picks the widest path the CPU supports and takes the sparse shortcut for sparse rows of k, the
+        // others force one path for every row so VERIFY_SHORTEST_PATHS can check each of them.
+        enum class RelaxPath { Best, Scalar, Sse, Avx2 };
+        // Runs all k steps, distance and next are vertexCount x vertexCount row-major buffers updated in place. Returns how many
+        // (i, j) pairs were relaxed through some k, rows that can't reach k and skipped columns not counted.
+        static long long ShortestPaths(std::vector<int>& distance, std::vector<int>& next, int vertexCount, int threadCount = 1,
+            RelaxPath path = RelaxPath::Best);
+        // Whether this build and CPU can run path.
+        static bool PathSupported(RelaxPath path);
+        // Plain triple loop used to check the kernel against, same update rule as the original implementation.
+        static void ShortestPathsReference(std::vector<int>& distance, std::vector<int>& next, int vertexCount);
+    private:
+        typedef void (*RelaxRow)(int*, int*, const int*, int, int, int, int);
+        static constexpr int TILE_WIDTH = 2048;
+        // Row k is handled column by column when fewer than 1 in SPARSE_RATIO of its entries are reachable.
+        static constexpr int SPARSE_RATIO = 16;
+        static void relax_row_sparse(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, const std::vector<int>& columns);
+        static RelaxRow select_relax_row(RelaxPath path);
+        static long long relax_step(std::vector<int>& distance, std::vector<int>& next, int vertexCount, int k, int rowBegin, int rowEnd, RelaxRow relaxRow,
+            bool allowSparse, std::vector<int>& activeRows, std::vector<int>& activeColumns);
+        static void relax_row_scalar(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, int begin, int end);
+#ifdef MIN_PLUS_KERNEL_X86
+        static void relax_row_sse(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, int begin, int end);
+        static void relax_row_avx2(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, int begin, int end);
+#endif
+};
+
+long long MinPlusKernel::ShortestPaths(std::vector<int>& distance, std::vector<int>& next, int vertexCount, int threadCount, RelaxPath path)
+{
+    RelaxRow relaxRow = select_relax_row(path);
+    bool allowSparse = path == RelaxPath::Best;
+    threadCount = std::max(1, std::min(threadCount, vertexCount));
+    ThreadBarrier stepBarrier(threadCount);
+    // Counted per thread and step, never per element.
+    std::vector<long long> relaxations(threadCount, 0);
+
+    auto worker = [&](int threadIndex)
+    {
+        int rowBegin = (int)((long long)vertexCount * threadIndex / threadCount);
+        int rowEnd = (int)((long long)vertexCount * (threadIndex + 1) / threadCount);
+        std::vector<int> activeRows;
+        std::vector<int> activeColumns;
+
+        for (int k = 0; k < vertexCount; k++)
+        {
+            relaxations[threadIndex] += relax_step(distance, next, vertexCount, k, rowBegin, rowEnd, relaxRow, allowSparse, activeRows, activeColumns);
+            // Row k + 1 may still be written by another thread, nobody starts the next step until all are done.
+            stepBarrier.Wait();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int threadIndex = 1; threadIndex < threadCount; threadIndex++)
+    {
+        workers.emplace_back(worker, threadIndex);
+    }
+    worker(0);
+
+    for (std::thread& thread : workers)
+    {
+        thread.join();
+    }
+
+    long long totalRelaxations = 0;
+    for (long long threadRelaxations : relaxations)
+    {
+        totalRelaxations += threadRelaxations;
+    }
+    return totalRelaxations;
+}
+
+bool MinPlusKernel::PathSupported(RelaxPath path)
+{
+#ifdef MIN_PLUS_KERNEL_X86
+    if (path == RelaxPath::Avx2)
+    {
+        return __builtin_cpu_supports("avx2");
+    }
+    else if (path == RelaxPath::Sse)
+    {
+        return __builtin_cpu_supports("sse4.1");
+    }
+    return true;
+#else
+    return path == RelaxPath::Best || path == RelaxPath::Scalar;
+#endif
+}
+
+MinPlusKernel::RelaxRow MinPlusKernel::select_relax_row(RelaxPath path)
+{
+#ifdef MIN_PLUS_KERNEL_X86
+    if ((path == RelaxPath::Best || path == RelaxPath::Avx2) && PathSupported(RelaxPath::Avx2))
+    {
+        return relax_row_avx2;
+    }
+    else if ((path == RelaxPath::Best || path == RelaxPath::Sse) && PathSupported(RelaxPath::Sse))
+    {
+        return relax_row_sse;
+    }
+#endif
+    return relax_row_scalar;
+}
+
+// Relaxes rows rowBegin to rowEnd through vertex k and returns how many entries it looked at. activeRows and activeColumns are
+// scratch space kept by the caller between steps.
+long long MinPlusKernel::relax_step(std::vector<int>& distance, std::vector<int>& next, int vertexCount, int k, int rowBegin, int rowEnd, RelaxRow relaxRow,
+    bool allowSparse, std::vector<int>& activeRows, std::vector<int>& activeColumns)
+{
+    // Rows with no path to k can't be improved through it, skip them for the whole step.
+    activeRows.clear();
+    for (int i = rowBegin; i < rowEnd; i++)
+    {
+        if (distance[(size_t)i * vertexCount + k] < INF)
+        {
+            activeRows.push_back(i);
+        }
+    }
+
+    if (activeRows.empty())
+    {
+        return 0;
+    }
+
+    const int* kRow = &distance[(size_t)k * vertexCount];
+    activeColumns.clear();
+    for (int j = 0; j < vertexCount; j++)
+    {
+        if (kRow[j] < INF)
+        {
+            activeColumns.push_back(j);
+        }
+    }
+
+    // Departure graphs are sparse, when k reaches few vertices only those columns are worth touching.
+    if (allowSparse && activeColumns.size() * SPARSE_RATIO < vertexCount)
+    {
+        for (int i : activeRows)
+        {
+            size_t rowStart = (size_t)i * vertexCount;
+            relax_row_sparse(&distance[rowStart], &next[rowStart], kRow, distance[rowStart + k], next[rowStart + k], activeColumns);
+        }
+        return (long long)activeRows.size() * activeColumns.size();
+    }
+
+    for (int begin = 0; begin < vertexCount; begin += TILE_WIDTH)
+    {
+        int end = begin + TILE_WIDTH < vertexCount ? begin + TILE_WIDTH : vertexCount;
+        for (int i : activeRows)
+        {
+            size_t rowStart = (size_t)i * vertexCount;
+            relaxRow(&distance[rowStart], &next[rowStart], kRow, distance[rowStart + k], next[rowStart + k], begin, end);
+        }
+    }
+
+    return (long long)activeRows.size() * vertexCount;
+}
+
+void MinPlusKernel::ShortestPathsReference(std::vector<int>& distance, std::vector<int>& next, int vertexCount)
+{
+    for (int k = 0; k < vertexCount; k++)
+    {
+        for (int i = 0; i < vertexCount; i++)
+        {
+            for (int j = 0; j < vertexCount; j++)
+            {
+                size_t ij = (size_t)i * vertexCount + j;
+                size_t ik = (size_t)i * vertexCount + k;
+                size_t kj = (size_t)k * vertexCount + j;
+                if (distance[ik] < INF && distance[kj] < INF && distance[ik] + distance[kj] < distance[ij])
+                {
+                    distance[ij] = distance[ik] + distance[kj];
+                    next[ij] = next[ik];
+                }
+            }
+        }
+    }
+}
+
+void MinPlusKernel::relax_row_scalar(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, int begin, int end)
+{
+    for (int j = begin; j < end; j++)
+    {
+        int candidate = distanceIK + kRow[j];
+        if (candidate < distanceRow[j])
+        {
+            distanceRow[j] = candidate;
+            nextRow[j] = nextIK;
+        }
+    }
+}
+
+void MinPlusKernel::relax_row_sparse(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, const std::vector<int>& columns)
+{
+    for (int j : columns)
+    {
+        int candidate = distanceIK + kRow[j];
+        if (candidate < distanceRow[j])
+        {
+            distanceRow[j] = candidate;
+            nextRow[j] = nextIK;
+        }
+    }
+}
+
+#ifdef MIN_PLUS_KERNEL_X86
+__attribute__((target("sse4.1")))
+void MinPlusKernel::relax_row_sse(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, int begin, int end)
+{
+    const __m128i distanceIKs = _mm_set1_epi32(distanceIK);
+    const __m128i nextIKs = _mm_set1_epi32(nextIK);
+
+    int j = begin;
+    for (; j + 4 <= end; j += 4)
+    {
+        __m128i candidate = _mm_add_epi32(distanceIKs, _mm_loadu_si128((const __m128i*)(kRow + j)));
+        __m128i current = _mm_loadu_si128((const __m128i*)(distanceRow + j));
+        __m128i shorter = _mm_cmpgt_epi32(current, candidate);
+        if (_mm_testz_si128(shorter, shorter))
+        {
+            continue;
+        }
+
+        _mm_storeu_si128((__m128i*)(distanceRow + j), _mm_min_epi32(current, candidate));
+        __m128i currentNext = _mm_loadu_si128((const __m128i*)(nextRow + j));
+        _mm_storeu_si128((__m128i*)(nextRow + j), _mm_blendv_epi8(currentNext, nextIKs, shorter));
+    }
+
+    relax_row_scalar(distanceRow, nextRow, kRow, distanceIK, nextIK, j, end);
+}
+
+__attribute__((target("avx2")))
+void MinPlusKernel::relax_row_avx2(int* distanceRow, int* nextRow, const int* kRow, int distanceIK, int nextIK, int begin, int end)
+{
+    const __m256i distanceIKs = _mm256_set1_epi32(distanceIK);
+    const __m256i nextIKs = _mm256_set1_epi32(nextIK);
+
+    int j = begin;
+    for (; j + 8 <= end; j += 8)
+    {
+        __m256i candidate = _mm256_add_epi32(distanceIKs, _mm256_loadu_si256((const __m256i*)(kRow + j)));
+        __m256i current = _mm256_loadu_si256((const __m256i*)(distanceRow + j));
+        __m256i shorter = _mm256_cmpgt_epi32(current, candidate);
+        if (_mm256_testz_si256(shorter, shorter))
+        {
+            continue;
+        }
+
+        _mm256_storeu_si256((__m256i*)(distanceRow + j), _mm256_min_epi32(current, candidate));
+        __m256i currentNext = _mm256_loadu_si256((const __m256i*)(nextRow + j));
+        _mm256_storeu_si256((__m256i*)(nextRow + j), _mm256_blendv_epi8(currentNext, nextIKs, shorter));
+    }
+
+    relax_row_scalar(distanceRow, nextRow, kRow, distanceIK, nextIK, j, end);
+}
+#endif
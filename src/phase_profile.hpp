@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+
+// Wall clock seconds of the named phases of a load in the order they ran, and named counts of the work they did (vertices, edges,
+// relaxations). Used by --stats and the benchmark to see which stage of building a schedule is responsible for its time.
+class PhaseProfile {
+    public:
+        // Runs step and records how long it took under name.
+        template<typename Step>
+        void Time(const std::string& name, Step step);
+        void AddPhase(const std::string& name, double seconds);
+        void AddCount(const std::string& name, long long count);
+        // Appends the phases and counts of another profile, the graph build is recorded by the graph and appended to the schedule load.
+        void Append(const PhaseProfile& other);
+        const std::vector<std::pair<std::string, double>>& GetPhases() const;
+        const std::vector<std::pair<std::string, long long>>& GetCounts() const;
+        double GetTotalSeconds() const;
+        // Writes {"phases": {"<phase>": seconds, ...}, "counts": {"<count>": value, ...}} without a line break.
+        void WriteJson(std::ostream& output) const;
+        // Writes one line per phase with its milliseconds and share of the total, then one line per count.
+        void WriteReport(std::ostream& output) const;
+    private:
+        std::vector<std::pair<std::string, double>> phases;
+        std::vector<std::pair<std::string, long long>> counts;
+};
+
+template<typename Step>
+void PhaseProfile::Time(const std::string& name, Step step)
+{
+    auto start = std::chrono::steady_clock::now();
+    step();
+    AddPhase(name, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void PhaseProfile::AddPhase(const std::string& name, double seconds)
+{
+    phases.push_back({name, seconds});
+}
+
+void PhaseProfile::AddCount(const std::string& name, long long count)
+{
+    counts.push_back({name, count});
+}
+
+void PhaseProfile::Append(const PhaseProfile& other)
+{
+    phases.insert(phases.end(), other.phases.begin(), other.phases.end());
+    counts.insert(counts.end(), other.counts.begin(), other.counts.end());
+}
+
+const std::vector<std::pair<std::string, double>>& PhaseProfile::GetPhases() const
+{
+    return phases;
+}
+
+const std::vector<std::pair<std::string, long long>>& PhaseProfile::GetCounts() const
+{
+    return counts;
+}
+
+double PhaseProfile::GetTotalSeconds() const
+{
+    double totalSeconds = 0;
+    for (const std::pair<std::string, double>& phase : phases)
+    {
+        totalSeconds += phase.second;
+    }
+    return totalSeconds;
+}
+
+void PhaseProfile::WriteJson(std::ostream& output) const
+{
+    output << "{\"phases\": {";
+    for (int i = 0; i < phases.size(); i++)
+    {
+        output << (i > 0 ? ", \"" : "\"") << phases[i].first << "\": " << phases[i].second;
+    }
+    output << "}, \"counts\": {";
+    for (int i = 0; i < counts.size(); i++)
+    {
+        output << (i > 0 ? ", \"" : "\"") << counts[i].first << "\": " << counts[i].second;
+    }
+    output << "}}";
+}
+
+void PhaseProfile::WriteReport(std::ostream& output) const
+{
+    double totalSeconds = GetTotalSeconds();
+    std::ios::fmtflags previousFlags = output.flags();
+    output << std::fixed << std::setprecision(3);
+    for (const std::pair<std::string, double>& phase : phases)
+    {
+        output << std::left << std::setw(48) << phase.first << std::right << std::setw(12) << phase.second * 1000 << " ms"
+               << std::setw(8) << std::setprecision(1) << (totalSeconds > 0 ? phase.second * 100 / totalSeconds : 0) << " %\n"
+               << std::setprecision(3);
+    }
+    output << std::left << std::setw(48) << "total" << std::right << std::setw(12) << totalSeconds * 1000 << " ms\n";
+    for (const std::pair<std::string, long long>& count : counts)
+    {
+        output << std::left << std::setw(48) << count.first << std::right << std::setw(15) << count.second << '\n';
+    }
+    output.flags(previousFlags);
+}
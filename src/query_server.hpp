@@ -0,0 +1,188 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+#include <iostream>
+#include <csignal>
+#include <pthread.h>
+#include <poll.h>
+#include "local_socket.hpp"
+#include "batch_query.hpp"
+#include "station_graph.hpp"
+
+/*
+    Serves the batch queries (see batch_query.hpp) over a local socket so many clients share one loaded graph. The protocol is the
+    batch format, a client writes query lines and reads one result line per query in the same order. Queries can be pipelined,
+    results that are ready together go back in one write.
+
+    A fixed pool of workers each serve one connection at a time from a queue filled by the accepting thread, so with more
+    connections than workers the extra ones wait for a worker. Workers share the graph, which lets queries run together and
+    makes add, cancel and delay wait for them, see StationGraph::graphLock. Runs until SIGINT or SIGTERM.
+*/
+
+class QueryServer {
+    public:
+        QueryServer(StationGraph& graph, const std::vector<StationRecord>& stations, int workers);
+        // Listens on address (TCP port or UNIX socket path, see LocalSocket) and serves until stopped. Throws if it can't listen.
+        void Run(const std::string& address);
+    private:
+        // Longest query line a client may send, a connection sending a longer one is answered with an error and closed.
+        static const size_t MAX_QUERY_BYTES = 4096;
+        StationGraph& stationGraph;
+        const std::vector<StationRecord>& stationLookupTable;
+        const int workerCount;
+        std::mutex connectionMutex;
+        std::condition_variable connectionReady;
+        // Accepted connections waiting for a worker.
+        std::deque<int> pendingConnections;
+        // Connections a worker is serving, shut down on stop so blocked reads return.
+        std::unordered_set<int> activeConnections;
+        bool stopping = false;
+        inline static volatile std::sig_atomic_t stopRequested = 0;
+        static void request_stop(int signal);
+        void worker_loop();
+        void serve_connection(int connectionFd, BatchQuery& batch);
+};
+
+QueryServer::QueryServer(StationGraph& graph, const std::vector<StationRecord>& stations, int workers)
+    : stationGraph(graph), stationLookupTable(stations), workerCount(workers)
+{
+}
+
+void QueryServer::Run(const std::string& address)
+{
+    SocketFileID socketFile;
+    int listenFd = LocalSocket::Listen(address, socketFile);
+
+    // Workers start with the stop signals blocked so they are always delivered to this thread.
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&QueryServer::worker_loop, this);
+    }
+
+    stopRequested = 0;
+    struct sigaction stopAction = {};
+    stopAction.sa_handler = request_stop;
+    sigaction(SIGINT, &stopAction, nullptr);
+    sigaction(SIGTERM, &stopAction, nullptr);
+    pthread_sigmask(SIG_UNBLOCK, &stopSignals, nullptr);
+
+    std::cout << "Serving queries on " << address << " with " << workerCount << " workers" << std::endl;
+
+    // Poll with a timeout so a stop signal is noticed even if it lands just before poll is entered.
+    pollfd listenPoll = {listenFd, POLLIN, 0};
+    while (!stopRequested)
+    {
+        if (poll(&listenPoll, 1, 200) <= 0)
+        {
+            continue;
+        }
+
+        int connectionFd = accept(listenFd, nullptr, nullptr);
+        if (connectionFd < 0)
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        pendingConnections.push_back(connectionFd);
+        connectionReady.notify_one();
+    }
+
+    LocalSocket::StopListening(listenFd, address, socketFile);
+
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        stopping = true;
+        for (int connectionFd : activeConnections)
+        {
+            shutdown(connectionFd, SHUT_RDWR);
+        }
+        for (int connectionFd : pendingConnections)
+        {
+            close(connectionFd);
+        }
+        pendingConnections.clear();
+    }
+    connectionReady.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    std::cout << "Server stopped" << std::endl;
+}
+
+void QueryServer::request_stop(int)
+{
+    stopRequested = 1;
+}
+
+void QueryServer::worker_loop()
+{
+    // Each worker keeps its own query parser, only the graph is shared.
+    BatchQuery batch(stationGraph, stationLookupTable);
+    while (true)
+    {
+        int connectionFd = -1;
+        {
+            std::unique_lock<std::mutex> lock(connectionMutex);
+            connectionReady.wait(lock, [this] { return stopping || !pendingConnections.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            connectionFd = pendingConnections.front();
+            pendingConnections.pop_front();
+            activeConnections.insert(connectionFd);
+        }
+
+        serve_connection(connectionFd, batch);
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        activeConnections.erase(connectionFd);
+        close(connectionFd);
+    }
+}
+
+void QueryServer::serve_connection(int connectionFd, BatchQuery& batch)
+{
+    SocketLineReader reader(connectionFd, MAX_QUERY_BYTES);
+    std::string line;
+    std::string results;
+    while (reader.ReadLine(line))
+    {
+        batch.Answer(line, results);
+        results.push_back('\n');
+
+        // Hold results back while more queries are already buffered, a pipelining client gets them in one write.
+        if (!reader.HasBufferedLine())
+        {
+            if (!LocalSocket::WriteAll(connectionFd, results.data(), results.size()))
+            {
+                return;
+            }
+            results.clear();
+        }
+    }
+
+    if (reader.LineTooLong())
+    {
+        results += "error query line too long\n";
+        LocalSocket::WriteAll(connectionFd, results.data(), results.size());
+    }
+}
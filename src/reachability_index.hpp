@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Yes or no answers for station pairs, one bit per pair. Row i holds the stations reached from station i + 1, packed 64 to a word.
+// The station graph fills one index with the stations a time respecting journey can reach and one with the nonstop pairs.
+class ReachabilityIndex {
+    public:
+        bool Contains(int departureStationID, int destinationStationID) const;
+        void Add(int departureStationID, int destinationStationID);
+        // Adds the stations set in stations, a row of GetRowWords words laid out like the index.
+        void AddRow(int departureStationID, const uint64_t* stations);
+        void ClearRow(int departureStationID);
+        int GetRowWords() const;
+        size_t GetBytes() const;
+        ReachabilityIndex(int stationsCount);
+    private:
+        const int stationCount;
+        const int rowWords;
+        std::vector<uint64_t> stationBits;
+};
+
+ReachabilityIndex::ReachabilityIndex(int stationsCount)
+    : stationCount(stationsCount), rowWords((stationsCount + 63) / 64), stationBits((size_t)stationsCount * ((stationsCount + 63) / 64), 0)
+{
+}
+
+bool ReachabilityIndex::Contains(int departureStationID, int destinationStationID) const
+{
+    if (departureStationID < 1 || departureStationID > stationCount || destinationStationID < 1 || destinationStationID > stationCount)
+    {
+        return false;
+    }
+
+    int bit = destinationStationID - 1;
+    return (stationBits[(size_t)(departureStationID - 1) * rowWords + bit / 64] >> (bit % 64)) & 1;
+}
+
+void ReachabilityIndex::Add(int departureStationID, int destinationStationID)
+{
+    int bit = destinationStationID - 1;
+    stationBits[(size_t)(departureStationID - 1) * rowWords + bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+void ReachabilityIndex::AddRow(int departureStationID, const uint64_t* stations)
+{
+    uint64_t* row = stationBits.data() + (size_t)(departureStationID - 1) * rowWords;
+    for (int w = 0; w < rowWords; w++)
+    {
+        row[w] |= stations[w];
+    }
+}
+
+void ReachabilityIndex::ClearRow(int departureStationID)
+{
+    uint64_t* row = stationBits.data() + (size_t)(departureStationID - 1) * rowWords;
+    std::fill(row, row + rowWords, 0);
+}
+
+int ReachabilityIndex::GetRowWords() const
+{
+    return rowWords;
+}
+
+size_t ReachabilityIndex::GetBytes() const
+{
+    return sizeof(ReachabilityIndex) + stationBits.capacity() * sizeof(uint64_t);
+}
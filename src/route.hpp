@@ -1,17 +1,26 @@
 #pragma once
 #include <vector>
-#include "departure.hpp"
 #include "trip.hpp"
 
+// A vertex the route passes through, as printed: the station and the HHMM time the next trip leaves it, 0 at the destination.
+struct RouteStop {
+    int stationID;
+    int departureTime;
+};
+
 struct Route {
     bool RouteIsValid();
-    Departure departingStation;
+    // Departure graph key of the first trip, -1 when there is no route.
+    int departureKey;
     std::vector<TripPlusLayover> tripList;
+    // The departing stop then the stop each trip leads to. Filled in by the StationGraph query under the lock it searched with,
+    // so printing never looks keys up in a graph an update may have renumbered since.
+    std::vector<RouteStop> stops;
 };
 
 bool Route::RouteIsValid()
 {
-    if(tripList.size() > 0 && departingStation.GetTripCount() > 0)
+    if(tripList.size() > 0 && departureKey >= 0)
     {
         return true;
     }         
@@ -0,0 +1,167 @@
+#pragma once
+#include <vector>
+#include <list>
+#include <mutex>
+#include <cstddef>
+#include <algorithm>
+#include <unordered_map>
+#include "trip.hpp"
+
+// Identifies a route query, twentyFourTime is negative for queries that allow any departure time.
+struct RouteCacheKey {
+    int departureStationID;
+    int destinationStationID;
+    int twentyFourTime;
+    bool includeLayovers;
+    bool operator==(const RouteCacheKey& other) const;
+};
+
+struct RouteCacheKeyHash {
+    size_t operator()(const RouteCacheKey& key) const;
+};
+
+// Result of a route query without the departure vertex copy, departureKey is -1 when no route exists.
+struct CachedRoute {
+    int departureKey;
+    std::vector<TripPlusLayover> tripList;
+};
+
+struct RouteCacheStats {
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long entries;
+};
+
+// Least recently used route results, split into shards that each have their own lock so concurrent queries rarely wait on each
+// other. Each shard holds at most its share of the entry budget.
+class RouteCache {
+    public:
+        // Copies the cached result for key into route and returns true on a hit.
+        bool Find(const RouteCacheKey& key, CachedRoute& route);
+        void Insert(const RouteCacheKey& key, const CachedRoute& route);
+        // Drops every result, used when the timetable changes. Counters are kept.
+        void Clear();
+        RouteCacheStats GetStats();
+        // Bytes of the cached results and their list and map nodes, bucket arrays aside.
+        size_t GetBytes();
+        RouteCache(size_t maxEntries);
+    private:
+        static const int SHARD_COUNT = 16;
+        typedef std::pair<RouteCacheKey, CachedRoute> Entry;
+        struct Shard {
+            std::mutex shardLock;
+            // Most recently used first.
+            std::list<Entry> entries;
+            std::unordered_map<RouteCacheKey, std::list<Entry>::iterator, RouteCacheKeyHash> entryByKey;
+            long long hits = 0;
+            long long misses = 0;
+            long long evictions = 0;
+        };
+        std::vector<Shard> shards;
+        size_t shardCapacity;
+        Shard& shard_for(const RouteCacheKey& key);
+};
+
+bool RouteCacheKey::operator==(const RouteCacheKey& other) const
+{
+    return departureStationID == other.departureStationID && destinationStationID == other.destinationStationID &&
+        twentyFourTime == other.twentyFourTime && includeLayovers == other.includeLayovers;
+}
+
+size_t RouteCacheKeyHash::operator()(const RouteCacheKey& key) const
+{
+    size_t hash = (size_t)key.departureStationID * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (size_t)key.destinationStationID) * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (size_t)(key.twentyFourTime + 1)) * 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 29) ^ (key.includeLayovers ? 1 : 0);
+}
+
+RouteCache::RouteCache(size_t maxEntries) : shards(SHARD_COUNT)
+{
+    shardCapacity = std::max((size_t)1, (maxEntries + SHARD_COUNT - 1) / SHARD_COUNT);
+}
+
+RouteCache::Shard& RouteCache::shard_for(const RouteCacheKey& key)
+{
+    // The low bits also pick the hash map bucket, the shard uses the high ones.
+    return shards[(RouteCacheKeyHash()(key) >> 48) % SHARD_COUNT];
+}
+
+bool RouteCache::Find(const RouteCacheKey& key, CachedRoute& route)
+{
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> guard(shard.shardLock);
+    auto entry = shard.entryByKey.find(key);
+    if (entry == shard.entryByKey.end())
+    {
+        shard.misses++;
+        return false;
+    }
+
+    shard.hits++;
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry->second);
+    route = entry->second->second;
+    return true;
+}
+
+void RouteCache::Insert(const RouteCacheKey& key, const CachedRoute& route)
+{
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> guard(shard.shardLock);
+    if (shard.entryByKey.count(key))
+    {
+        // Another query computed the same result first.
+        return;
+    }
+
+    if (shard.entries.size() >= shardCapacity)
+    {
+        shard.entryByKey.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+        shard.evictions++;
+    }
+
+    shard.entries.push_front({key, route});
+    shard.entryByKey[key] = shard.entries.begin();
+}
+
+void RouteCache::Clear()
+{
+    for (Shard& shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard.shardLock);
+        shard.entries.clear();
+        shard.entryByKey.clear();
+    }
+}
+
+RouteCacheStats RouteCache::GetStats()
+{
+    RouteCacheStats stats = {0, 0, 0, 0};
+    for (Shard& shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard.shardLock);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.entries += shard.entries.size();
+    }
+    return stats;
+}
+
+size_t RouteCache::GetBytes()
+{
+    size_t bytes = 0;
+    for (Shard& shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard.shardLock);
+        for (const Entry& entry : shard.entries)
+        {
+            // A list node holds two pointers next to the entry, a map node one pointer next to the key and iterator.
+            bytes += 2 * sizeof(void*) + sizeof(Entry) + entry.second.tripList.capacity() * sizeof(TripPlusLayover) +
+                sizeof(void*) + sizeof(RouteCacheKey) + sizeof(std::list<Entry>::iterator);
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include "trip.hpp"
+
+// All trains running between the same pair of stations, ordered by departure time. Used by the round based (RAPTOR) queries,
+// each pattern is scanned once per round instead of looking at each train on its own.
+class RoutePattern {
+    public:
+        int GetDepartureStationID() const;
+        int GetDestinationStationID() const;
+        int GetTripCount() const;
+        Connection GetTrip(int tripIndex) const;
+        int FindEarliestArrival(int twentyFourTime, bool exactDeparture) const;
+        void AddTrip(Connection trip);
+        void SortTrips();
+        size_t GetBytes() const;
+        RoutePattern(int departureID, int destinationID);
+    private:
+        std::vector<Connection> trips;
+        // For each trip index, the index of the earliest arriving trip leaving at or after it.
+        std::vector<int> earliestArrivalFrom;
+        int departureStationID;
+        int destinationStationID;
+};
+
+RoutePattern::RoutePattern(int departureID, int destinationID)
+{
+    departureStationID = departureID;
+    destinationStationID = destinationID;
+}
+
+void RoutePattern::AddTrip(Connection trip)
+{
+    trips.push_back(trip);
+}
+
+void RoutePattern::SortTrips()
+{
+    std::stable_sort(trips.begin(), trips.end(),
+        [](const Connection& a, const Connection& b) { return a.departureTime < b.departureTime; });
+
+    // Trains between two stations do not have to arrive in the order they leave, so keep a running minimum from the back.
+    earliestArrivalFrom.assign(trips.size(), -1);
+    for (int i = (int)trips.size() - 1; i >= 0; i--)
+    {
+        int laterBest = i + 1 < trips.size() ? earliestArrivalFrom[i + 1] : -1;
+        earliestArrivalFrom[i] = (laterBest != -1 && trips[laterBest].arrivalTime < trips[i].arrivalTime) ? laterBest : i;
+    }
+}
+
+size_t RoutePattern::GetBytes() const
+{
+    return sizeof(RoutePattern) + trips.capacity() * sizeof(Connection) + earliestArrivalFrom.capacity() * sizeof(int);
+}
+
+// Returns the index of the earliest arriving trip that leaves after twentyFourTime, or exactly at it when exactDeparture is set.
+// Returns -1 if there is no such trip.
+int RoutePattern::FindEarliestArrival(int twentyFourTime, bool exactDeparture) const
+{
+    auto first = std::partition_point(trips.begin(), trips.end(), [twentyFourTime, exactDeparture](const Connection& trip)
+        { return exactDeparture ? trip.departureTime < twentyFourTime : trip.departureTime <= twentyFourTime; });
+
+    if (first == trips.end())
+    {
+        return -1;
+    }
+
+    int firstIndex = first - trips.begin();
+    if (!exactDeparture)
+    {
+        return earliestArrivalFrom[firstIndex];
+    }
+
+    int bestIndex = -1;
+    for (int i = firstIndex; i < trips.size() && trips[i].departureTime == twentyFourTime; i++)
+    {
+        if (bestIndex == -1 || trips[i].arrivalTime < trips[bestIndex].arrivalTime)
+        {
+            bestIndex = i;
+        }
+    }
+
+    return bestIndex;
+}
+
+Connection RoutePattern::GetTrip(int tripIndex) const
+{
+    return trips[tripIndex];
+}
+
+int RoutePattern::GetTripCount() const
+{
+    return trips.size();
+}
+
+int RoutePattern::GetDepartureStationID() const
+{
+    return departureStationID;
+}
+
+int RoutePattern::GetDestinationStationID() const
+{
+    return destinationStationID;
+}
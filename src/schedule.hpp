@@ -2,7 +2,6 @@
 #include <cstddef>
 #include <vector>
 #include <string>
-#include <sstream>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
@@ -10,13 +9,23 @@
 #include "utility.hpp"
 #include "route.hpp"
 #include "station_graph.hpp"
+#include "batch_query.hpp"
+#include "query_server.hpp"
 
 class Schedule{
     public:
-        //Constructor - create new schedule from data files.
-        Schedule(std::string stationData, std::string trainsData);
+        //Constructor - create new schedule from the paths of the data files, engine selects how routes are computed
+        //and precomputeThreads how many threads build the shortest path tables. treeCacheBytes bounds the trees the lazy engine keeps.
+        //routeCacheEntries is the number of route results cached, 0 disables the cache. Throws std::runtime_error if a file can't be read.
+        Schedule(const std::string& stationFilePath, const std::string& trainsFilePath, RouteEngine engine = RouteEngine::FloydWarshall, int precomputeThreads = 1,
+            size_t treeCacheBytes = StationGraph::DEFAULT_TREE_CACHE_BYTES, size_t routeCacheEntries = 0);
+        //Constructor - load a schedule written by WriteCompiled, verifyTables also checks the sequence table checksum.
+        Schedule(const std::string& compiledFilePath, RouteEngine engine, bool verifyTables, size_t treeCacheBytes = StationGraph::DEFAULT_TREE_CACHE_BYTES,
+            size_t routeCacheEntries = 0);
         //Destructor - destroy schedule
         ~Schedule();
+        //Write stations, trips, departure graph and sequence tables to a compiled timetable file.
+        void WriteCompiled(const std::string& compiledFilePath);
         //Print schedule for all stations
         void PrintCompleteSchedule();
         //Print schedule for selected station no arguments is overloaded to prompt for input
@@ -36,25 +45,76 @@ class Schedule{
         void ShortestTripLengthRideTime();
         //Gets the shortest time and itinerary to go from A to B, paths are weighted by layover time + travel time
         void ShortestTripLengthWithLayover();
-        //Returns the shortest time and itinerary  to go from A to B when departing at a specific time only.
+        //Returns the earliest arriving itinerary from A to B leaving at or after a given time, and its overall travel time.
         void ShortestTripDepartureTime(); 
+        //Gets the fastest itinerary from A to B for each number of transfers up to a maximum, paths are weighted by layover time + travel time
+        void ShortestTripsByTransfers();
+        //Gets every itinerary from A to B leaving within a departure window that no other one beats on both departure and arrival time
+        void TripsInDepartureWindow();
+        //Prints the next trains leaving a station at or after a given time
+        void PrintDepartureBoard();
+        //Answers queries read from input without prompting, one result line per query, see batch_query.hpp for the format.
+        //Returns the number of queries answered.
+        int RunBatch(std::istream& input, std::ostream& output);
+        //Answers the same queries for clients of a local socket until stopped, see query_server.hpp.
+        void Serve(const std::string& address, int workers);
+        //Time each step of loading took and the work counted along the way, reading the data files followed by the graph build.
+        const PhaseProfile& GetLoadProfile() const;
+        //Bytes held by the station and trip tables and every structure of the graph, followed by the allocations made while loading,
+        //the allocations made so far and the peak resident set of the process.
+        MemoryReport GetMemoryReport();
+        //The graph queries are answered from, for tools that call it directly such as the benchmark.
+        StationGraph& GetStationGraph();
     private:
-        std::vector<std::vector<std::string>> stationLookupTable;
-        std::vector<std::vector<std::string>> tripDataTable;
+        std::vector<StationRecord> stationLookupTable;
+        std::vector<Connection> tripDataTable;
         StationGraph* stationGraph;
+        // Mapping the graph reads its tables from when loaded from a compiled file, must outlive stationGraph.
+        CompiledTimetable* compiledTimetable = nullptr;
+        PhaseProfile loadProfile;
+        // Heap allocations made by the constructor, counted by AllocationCounter.
+        long long loadAllocations = 0;
+        long long loadAllocatedBytes = 0;
+        void start_allocation_count();
+        void stop_allocation_count();
         // Builds a lookup table to map station id to station name.
-        void build_station_lookup_table(std::string stationData);        
-        void build_trip_data_table(std::string trainsData);
+        void build_station_lookup_table(const std::string& stationFilePath);
+        void build_trip_data_table(const std::string& trainsFilePath);
         int prompt_twenty_four_time() const;
+        // Earliest arriving route from the 12 hour menu time twentyFourTime came from, searched from each of its readings.
+        // startTime is set to the reading the returned route was found from.
+        Route route_from_either_reading(int twentyFourTime, int departureID, int destinationID, int& startTime);
+        int prompt_clock_time() const;
         int prompt_station_id() const;
         std::pair<int, int> prompt_station_pair_id() const;        
+        void print_itinerary(const Route& tripRoute);
 };
 
-Schedule::Schedule(std::string stationData, std::string trainsData)
+Schedule::Schedule(const std::string& stationFilePath, const std::string& trainsFilePath, RouteEngine engine, int precomputeThreads, size_t treeCacheBytes, size_t routeCacheEntries)
 {
-    build_station_lookup_table(stationData);
-    build_trip_data_table(trainsData);
-    stationGraph = new StationGraph(tripDataTable, stationLookupTable, stationLookupTable.size());
+    start_allocation_count();
+    loadProfile.Time("build_station_lookup_table", [&] { build_station_lookup_table(stationFilePath); });
+    loadProfile.Time("build_trip_data_table", [&] { build_trip_data_table(trainsFilePath); });
+    loadProfile.AddCount("stations", stationLookupTable.size());
+    loadProfile.AddCount("trips", tripDataTable.size());
+    // Every station line holds one number and every trip line four, each parsed once.
+    loadProfile.AddCount("parsed_integer_fields", stationLookupTable.size() + 4 * tripDataTable.size());
+    stationGraph = new StationGraph(tripDataTable, stationLookupTable, stationLookupTable.size(), engine, precomputeThreads, nullptr, treeCacheBytes, routeCacheEntries);
+    loadProfile.Append(stationGraph->GetBuildProfile());
+    stop_allocation_count();
+}
+
+Schedule::Schedule(const std::string& compiledFilePath, RouteEngine engine, bool verifyTables, size_t treeCacheBytes, size_t routeCacheEntries)
+{
+    start_allocation_count();
+    loadProfile.Time("open_compiled_timetable", [&] { compiledTimetable = new CompiledTimetable(compiledFilePath, verifyTables); });
+    loadProfile.Time("read_compiled_stations", [&] { compiledTimetable->ReadStations(stationLookupTable); });
+    loadProfile.Time("read_compiled_trips", [&] { compiledTimetable->ReadTrips(tripDataTable); });
+    loadProfile.AddCount("stations", stationLookupTable.size());
+    loadProfile.AddCount("trips", tripDataTable.size());
+    stationGraph = new StationGraph(tripDataTable, stationLookupTable, stationLookupTable.size(), engine, 1, compiledTimetable, treeCacheBytes, routeCacheEntries);
+    loadProfile.Append(stationGraph->GetBuildProfile());
+    stop_allocation_count();
 }
 
 Schedule::~Schedule()
@@ -63,6 +123,15 @@ Schedule::~Schedule()
     {
         delete stationGraph;
     }
+    if(compiledTimetable)
+    {
+        delete compiledTimetable;
+    }
+}
+
+void Schedule::WriteCompiled(const std::string& compiledFilePath)
+{
+    stationGraph->WriteCompiled(compiledFilePath, stationLookupTable, tripDataTable);
 }
 
 void Schedule::PrintCompleteSchedule()
@@ -175,11 +244,11 @@ void Schedule::LookUpStationId()
     bool noMatch = true;
     for(int i = 0; i < stationLookupTable.size() && noMatch; i++)
     {
-        if(Utility::CompareStringsNoCase(stationLookupTable[i][1], stationName))
+        if(Utility::CompareStringsNoCase(stationLookupTable[i].name, stationName))
         {
             std::string possessive = tolower(stationName[stationName.size() - 1]) == 's' ? "'" : "'s"; 
-            std::cout << stationLookupTable[i][1] << possessive << " station id is " << 
-            stationLookupTable[i][0] << std::endl;
+            std::cout << stationLookupTable[i].name << possessive << " station id is " << 
+            stationLookupTable[i].stationID << std::endl;
             noMatch = false;
         }
     }
@@ -200,7 +269,7 @@ void Schedule::LookUpStationName()
     if(stationID > 0 && stationID <= stationLookupTable.size())
     {
         //stationID - 1 maps the input to the corresponding vector entry.
-        std::cout << "Station " << stationLookupTable[stationID - 1][0] << " is " << 
+        std::cout << "Station " << stationLookupTable[stationID - 1].stationID << " is " << 
             SimpleStationNameLookup(stationID) << std::endl;
     }
     else
@@ -213,7 +282,7 @@ std::string Schedule::SimpleStationNameLookup(int stationID)
 {
     if(stationID > 0 && stationID <= stationLookupTable.size())
     {
-        return stationLookupTable[stationID - 1][1];
+        return stationLookupTable[stationID - 1].name;
     }
     else
     {
@@ -274,19 +343,7 @@ void Schedule::ShortestTripLengthRideTime()
             << totalTripMins / 60 << " hours and " << totalTripMins % 60
             << " minutes. Layover time not included.\nItinerary\n----------\n";
 
-        Departure startDeparture = tripRoute.departingStation;        
-        for(int i = 0; i < tripRoute.tripList.size(); i++)
-        {
-            TripPlusLayover currentTrip = tripRoute.tripList[i];
-            Departure endDeparture = stationGraph->GetDepartureFromGraph(currentTrip.destinationKey);
-
-            std::cout << "Leave from " << SimpleStationNameLookup(startDeparture.GetStationID())
-                << " at "  << std::setw(4) << std::setfill('0') << startDeparture.GetDepartureTime()
-                << ", arrive at " << SimpleStationNameLookup(endDeparture.GetStationID()) << " at "
-                 << std::setw(4) << std::setfill('0') << startDeparture.GetDepartureTime() + currentTrip.rideTimeToDestinationMins << std::endl;
-
-            startDeparture = endDeparture;
-        }
+        print_itinerary(tripRoute);
     }
     else
     {
@@ -313,20 +370,7 @@ void Schedule::ShortestTripLengthWithLayover()
             << totalTripMins / 60 << " hours and " << totalTripMins % 60
             << " minutes including layovers.\nItinerary\n----------\n";
 
-        Departure startDeparture = tripRoute.departingStation;
-        for (int i = 0; i < tripRoute.tripList.size(); i++)
-        {
-            TripPlusLayover currentTrip = tripRoute.tripList[i];
-            Departure endDeparture = stationGraph->GetDepartureFromGraph(currentTrip.destinationKey);
-
-            std::cout << "Leave from " << SimpleStationNameLookup(startDeparture.GetStationID())
-                      << " at "  << std::setw(4) << std::setfill('0') << startDeparture.GetDepartureTime()
-                      << ", arrive at " << SimpleStationNameLookup(endDeparture.GetStationID()) << " at "
-                       << std::setw(4) << std::setfill('0') << startDeparture.GetDepartureTime() + currentTrip.rideTimeToDestinationMins
-                       << std::endl;
-
-            startDeparture = endDeparture;
-        }
+        print_itinerary(tripRoute);
     }
     else
     {
@@ -341,7 +385,8 @@ void Schedule::ShortestTripDepartureTime()
     std::cout << "When would you like to leave?\n";
 
     int time = prompt_twenty_four_time();
-    Route tripRoute = stationGraph->GetRouteFromTime(time, stationPair.first, stationPair.second);
+    int startTime = time;
+    Route tripRoute = route_from_either_reading(time, stationPair.first, stationPair.second, startTime);
     if (tripRoute.RouteIsValid())
     {
         int totalTripMins = 0;
@@ -349,82 +394,225 @@ void Schedule::ShortestTripDepartureTime()
         {
             totalTripMins += trip.tripWeight;
         }
-
-        std::cout << "\nShortest overall travel time from " << SimpleStationNameLookup(stationPair.first)
-                  << " to " << SimpleStationNameLookup(stationPair.second) << " \nis "
+        // Trip weights are differences of HHMM times, they telescope to the arrival at the destination.
+        int departureTime = tripRoute.stops[0].departureTime;
+        int arrivalTime = departureTime + totalTripMins;
+
+        std::cout << "\nEarliest arrival from " << SimpleStationNameLookup(stationPair.first)
+                  << " to " << SimpleStationNameLookup(stationPair.second) << " leaving at or after "
+                  << std::setw(4) << std::setfill('0') << startTime << "\nleaves at "
+                  << std::setw(4) << std::setfill('0') << departureTime << " and arrives at "
+                  << std::setw(4) << std::setfill('0') << arrivalTime << ", "
                   << totalTripMins / 60 << " hours and " << totalTripMins % 60
                   << " minutes including layovers.\nItinerary\n----------\n";
 
-        Departure startDeparture = tripRoute.departingStation;
-        for (int i = 0; i < tripRoute.tripList.size(); i++)
-        {
-            TripPlusLayover currentTrip = tripRoute.tripList[i];
-            Departure endDeparture = stationGraph->GetDepartureFromGraph(currentTrip.destinationKey);
-
-            std::cout << "Leave from " << SimpleStationNameLookup(startDeparture.GetStationID())
-                      << " at " << std::setw(4) << std::setfill('0') << startDeparture.GetDepartureTime()
-                      << ", arrive at " << SimpleStationNameLookup(endDeparture.GetStationID()) << " at " 
-                      << std::setw(4) << std::setfill('0')  << startDeparture.GetDepartureTime() + currentTrip.rideTimeToDestinationMins
-                      << std::endl;
-
-            startDeparture = endDeparture;
-        }
+        print_itinerary(tripRoute);
     }
     else
     {
+        // Neither reading has a route, so none leaves after the earlier one.
         std::cout << "There are no routes from " << SimpleStationNameLookup(stationPair.first) << " to "
-                  << SimpleStationNameLookup(stationPair.second) << " leaving at "  << std::setw(4) << std::setfill('0') << time;
+                  << SimpleStationNameLookup(stationPair.second) << " leaving at or after "  << std::setw(4) << std::setfill('0')
+                  << time % 1200 << std::endl;
+
+    }
+}
 
-        if(time > 1300)
+// The prompt reads a 12 hour clock and ToTwentyFourTime picks one reading, the other is 12 hours away. Each reading is searched
+// from its own start and the route with the shorter wait plus travel time wins, ties going to the reading ToTwentyFourTime picked.
+Route Schedule::route_from_either_reading(int twentyFourTime, int departureID, int destinationID, int& startTime)
+{
+    int readings[] = {twentyFourTime, twentyFourTime < 1200 ? twentyFourTime + 1200 : twentyFourTime - 1200};
+    Route bestRoute = {-1, {}};
+    int bestMinutes = Utility::INF;
+    startTime = twentyFourTime;
+    for (int reading : readings)
+    {
+        Route tripRoute = stationGraph->GetRouteFromTime(reading, departureID, destinationID);
+        if (!tripRoute.RouteIsValid())
         {
-            std::cout << " or " << std::setw(4) << std::setfill('0') << time - 1200 << std::endl;
+            continue;
         }
-        else
+
+        // The arrival is an HHMM time like the reading, both are turned into minutes of the day before they are compared.
+        int arrivalTime = tripRoute.stops[0].departureTime;
+        for (const TripPlusLayover& trip : tripRoute.tripList)
+        {
+            arrivalTime += trip.tripWeight;
+        }
+        int minutes = (arrivalTime / 100 * 60 + arrivalTime % 100) - (reading / 100 * 60 + reading % 100);
+
+        if (minutes < bestMinutes)
         {
-            std::cout << std::endl;
+            bestMinutes = minutes;
+            bestRoute = std::move(tripRoute);
+            startTime = reading;
         }
-        
     }
+
+    return bestRoute;
 }
 
-void Schedule::build_station_lookup_table(std::string stationData)
+void Schedule::ShortestTripsByTransfers()
 {
-    std::stringstream lineStream(stationData);
-    
-    std::string line;
-    while(getline(lineStream, line))
+    std::pair<int, int> stationPair = prompt_station_pair_id();
+    std::cout << "Enter maximum number of transfers: ";
+    int maxTransfers = Utility::GetIntFromUser();
+
+    std::vector<Route> routes = stationGraph->GetRoutesByTransfers(stationPair.first, stationPair.second, maxTransfers);
+    if (routes.empty())
+    {
+        std::cout << "There is no route from " << SimpleStationNameLookup(stationPair.first) << " to "
+                  << SimpleStationNameLookup(stationPair.second) << " with at most " << maxTransfers << " transfers.\n";
+        return;
+    }
+
+    std::cout << "\nFastest routes from " << SimpleStationNameLookup(stationPair.first) << " to "
+              << SimpleStationNameLookup(stationPair.second) << " by number of transfers\n";
+
+    for (Route& tripRoute : routes)
     {
-        std::stringstream tokenStream(line);
-        std::string token;
-        stationLookupTable.push_back({});
-        while(tokenStream >> token)
+        int totalTripMins = 0;
+        for (TripPlusLayover trip : tripRoute.tripList)
         {
-            stationLookupTable[stationLookupTable.size() - 1].push_back(token);
+            totalTripMins += trip.tripWeight;
         }
-    }
 
-    // sort the data in station table, not guaranteed to come in sorted.
-   std::sort(stationLookupTable.begin(), stationLookupTable.end(),
-        [](const std::vector<std::string>& a, const std::vector<std::string>& b) { return a[0] < b[0]; });
+        std::cout << "\nWith " << tripRoute.tripList.size() - 1 << " transfers the travel time is "
+                  << totalTripMins / 60 << " hours and " << totalTripMins % 60
+                  << " minutes including layovers.\nItinerary\n----------\n";
+        print_itinerary(tripRoute);
+    }
 }
 
-void Schedule::build_trip_data_table(std::string trainsData)
+void Schedule::TripsInDepartureWindow()
 {
-    std::stringstream lineStream(trainsData);
-    
-    std::string line;
-    while(getline(lineStream, line))
+    std::pair<int, int> stationPair = prompt_station_pair_id();
+    std::cout << "Earliest departure (24 hour time)\n";
+    Utility::ClearInStream();
+    int windowStart = prompt_clock_time();
+    std::cout << "Latest departure (24 hour time)\n";
+    int windowEnd = prompt_clock_time();
+
+    std::vector<Route> routes = stationGraph->GetRouteProfile(stationPair.first, stationPair.second, windowStart, windowEnd);
+    if (routes.empty())
     {
-        std::stringstream tokenStream(line);
-        std::string token;
-        tripDataTable.push_back({});
-        while(tokenStream >> token)
+        std::cout << "There are no routes from " << SimpleStationNameLookup(stationPair.first) << " to "
+                  << SimpleStationNameLookup(stationPair.second) << " leaving between " << std::setw(4) << std::setfill('0') << windowStart
+                  << " and " << std::setw(4) << std::setfill('0') << windowEnd << std::endl;
+        return;
+    }
+
+    std::cout << "\nRoutes from " << SimpleStationNameLookup(stationPair.first) << " to "
+              << SimpleStationNameLookup(stationPair.second) << " by departure time\n";
+
+    for (Route& tripRoute : routes)
+    {
+        int totalTripMins = 0;
+        for (TripPlusLayover trip : tripRoute.tripList)
         {
-            tripDataTable[tripDataTable.size() - 1].push_back(token);
+            totalTripMins += trip.tripWeight;
         }
+
+        std::cout << "\nLeaving at " << std::setw(4) << std::setfill('0') << tripRoute.stops[0].departureTime
+                  << " the travel time is " << totalTripMins / 60 << " hours and " << totalTripMins % 60
+                  << " minutes including layovers.\nItinerary\n----------\n";
+        print_itinerary(tripRoute);
     }
 }
 
+void Schedule::PrintDepartureBoard()
+{
+    int stationID = prompt_station_id();
+    std::cout << "Leaving at or after (24 hour time)\n";
+    Utility::ClearInStream();
+    int time = prompt_clock_time();
+    std::cout << "Number of departures: ";
+    int count = Utility::GetIntFromUser();
+
+    std::vector<Connection> departures = stationGraph->GetDepartureBoard(stationID, time, count);
+    if (departures.empty())
+    {
+        std::cout << "There are no departures from " << SimpleStationNameLookup(stationID) << " at or after "
+                  << std::setw(4) << std::setfill('0') << time << std::endl;
+        return;
+    }
+
+    std::cout << "Departures from " << SimpleStationNameLookup(stationID) << std::endl;
+    for (const Connection& trip : departures)
+    {
+        std::cout << std::setw(4) << std::setfill('0') << trip.departureTime << " to " << SimpleStationNameLookup(trip.arrivalStationID)
+                  << ", arriving at " << std::setw(4) << std::setfill('0') << trip.arrivalTime << std::endl;
+    }
+}
+
+int Schedule::RunBatch(std::istream& input, std::ostream& output)
+{
+    BatchQuery batch(*stationGraph, stationLookupTable);
+    return batch.Run(input, output);
+}
+
+void Schedule::Serve(const std::string& address, int workers)
+{
+    QueryServer server(*stationGraph, stationLookupTable, workers);
+    server.Run(address);
+}
+
+const PhaseProfile& Schedule::GetLoadProfile() const
+{
+    return loadProfile;
+}
+
+MemoryReport Schedule::GetMemoryReport()
+{
+    MemoryReport report;
+    size_t stationTableBytes = MemoryReport::GetVectorBytes(stationLookupTable);
+    for (const StationRecord& station : stationLookupTable)
+    {
+        stationTableBytes += MemoryReport::GetStringBytes(station.name);
+    }
+    report.AddStructure("station_lookup_table", stationTableBytes);
+    report.AddStructure("trip_data_table", MemoryReport::GetVectorBytes(tripDataTable));
+    report.Append(stationGraph->GetMemoryReport());
+    report.AddCount("load_allocations", loadAllocations);
+    report.AddCount("load_allocated_bytes", loadAllocatedBytes);
+    report.AddCount("allocations", AllocationCounter::GetAllocations());
+    report.AddCount("allocated_bytes", AllocationCounter::GetAllocatedBytes());
+    report.AddCount("peak_resident_bytes", MemoryReport::GetPeakResidentBytes());
+    return report;
+}
+
+void Schedule::start_allocation_count()
+{
+    loadAllocations = AllocationCounter::GetAllocations();
+    loadAllocatedBytes = AllocationCounter::GetAllocatedBytes();
+}
+
+void Schedule::stop_allocation_count()
+{
+    loadAllocations = AllocationCounter::GetAllocations() - loadAllocations;
+    loadAllocatedBytes = AllocationCounter::GetAllocatedBytes() - loadAllocatedBytes;
+}
+
+StationGraph& Schedule::GetStationGraph()
+{
+    return *stationGraph;
+}
+
+void Schedule::build_station_lookup_table(const std::string& stationFilePath)
+{
+    TimetableReader::ReadStations(stationFilePath, stationLookupTable);
+
+    // sort the data in station table, not guaranteed to come in sorted.
+    std::stable_sort(stationLookupTable.begin(), stationLookupTable.end(),
+        [](const StationRecord& a, const StationRecord& b) { return a.stationID < b.stationID; });
+}
+
+void Schedule::build_trip_data_table(const std::string& trainsFilePath)
+{
+    TimetableReader::ReadTrips(trainsFilePath, tripDataTable, stationLookupTable.size());
+}
+
 int Schedule::prompt_twenty_four_time() const
 {
     std::cout << "Enter time (HH:MM): ";
@@ -461,19 +649,32 @@ int Schedule::prompt_twenty_four_time() const
         }
     }
 
-    int twentyFourTime = 0;
     int hour = (firstH * 10) + secondH;
     int min = (firstM * 10) + secondM;
-    if(hour < 12 && hour > 1)
-    {
-        twentyFourTime = (hour + 12) * 100;
-    }
-    else
+    return Utility::ToTwentyFourTime(hour, min);
+}
+
+// Reads HH:MM as written, 00:00 to 23:59, unlike prompt_twenty_four_time which reads hours as a 12 hour clock.
+int Schedule::prompt_clock_time() const
+{
+    std::cout << "Enter time (HH:MM): ";
+    while (true)
     {
-        twentyFourTime = hour * 100;
-    }
+        std::string line;
+        std::getline(std::cin, line);
+
+        if (line.size() >= 5 && line[2] == ':' && isdigit(line[0]) && isdigit(line[1]) && isdigit(line[3]) && isdigit(line[4]))
+        {
+            int hour = (line[0] - '0') * 10 + (line[1] - '0');
+            int minute = (line[3] - '0') * 10 + (line[4] - '0');
+            if (hour <= 23 && minute <= 59)
+            {
+                return hour * 100 + minute;
+            }
+        }
 
-    return (twentyFourTime += min);    
+        std::cout << "Invalid time, must be in HH:MM format: ";
+    }
 }
 
 int Schedule::prompt_station_id() const
@@ -510,5 +711,17 @@ std::pair<int, int> Schedule::prompt_station_pair_id() const
     return {departID, destID};
 }
 
-
-
+void Schedule::print_itinerary(const Route& tripRoute)
+{
+    for (int i = 0; i < tripRoute.tripList.size(); i++)
+    {
+        TripPlusLayover currentTrip = tripRoute.tripList[i];
+        const RouteStop& start = tripRoute.stops[i];
+
+        std::cout << "Leave from " << SimpleStationNameLookup(start.stationID)
+                  << " at " << std::setw(4) << std::setfill('0') << start.departureTime
+                  << ", arrive at " << SimpleStationNameLookup(tripRoute.stops[i + 1].stationID) << " at "
+                  << std::setw(4) << std::setfill('0') << start.departureTime + currentTrip.rideTimeToDestinationMins
+                  << std::endl;
+    }
+}
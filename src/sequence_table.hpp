@@ -0,0 +1,169 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "utility.hpp"
+
+// Next hop table produced by floyd_warshal_shortest_paths, a flat row-major vertexCount x vertexCount array. Entries are stored in
+// the narrowest unsigned type that holds every vertex key, 16 bits below 65535 vertices and 32 bits otherwise, with the type's
+// maximum marking "no path". The entries are either owned by the table or point into a compiled timetable mapping, lookups
+// are the same either way and still return Utility::INF where no path exists.
+class SequenceTable {
+    public:
+        int GetNextStop(int fromKey, int toKey) const;
+        int GetVertexCount() const;
+        // Raw entries, GetEntryBytes(vertexCount) bytes each.
+        const void* GetData() const;
+        static size_t GetEntryBytes(int vertices);
+        // Bytes owned by the table, entries read from a mapping are not counted.
+        size_t GetBytes() const;
+        // Replaces the next hops from fromKey, nextStops holds Utility::INF where no path exists. A mapped table is copied first.
+        void SetRow(int fromKey, const std::vector<int>& nextStops);
+        // Adds an empty row and column at vertexKey, keys from vertexKey on move up by one.
+        void InsertVertex(int vertexKey);
+        // Narrows tableEntries, which hold Utility::INF where no path exists.
+        SequenceTable(int vertices, const std::vector<int>& tableEntries);
+        SequenceTable(int vertices, const void* mappedEntries);
+    private:
+        std::vector<uint16_t> ownedNarrowEntries;
+        std::vector<uint32_t> ownedWideEntries;
+        const uint16_t* narrowEntries = nullptr;
+        const uint32_t* wideEntries = nullptr;
+        int vertexCount;
+        static constexpr uint16_t NARROW_NO_PATH = UINT16_MAX;
+        static constexpr uint32_t WIDE_NO_PATH = UINT32_MAX;
+        void assign(int vertices, const std::vector<int>& tableEntries);
+};
+
+SequenceTable::SequenceTable(int vertices, const std::vector<int>& tableEntries)
+{
+    assign(vertices, tableEntries);
+}
+
+void SequenceTable::assign(int vertices, const std::vector<int>& tableEntries)
+{
+    vertexCount = vertices;
+    ownedNarrowEntries.clear();
+    ownedWideEntries.clear();
+    narrowEntries = nullptr;
+    wideEntries = nullptr;
+    if (GetEntryBytes(vertices) == sizeof(uint16_t))
+    {
+        ownedNarrowEntries.resize(tableEntries.size());
+        for (size_t i = 0; i < tableEntries.size(); i++)
+        {
+            ownedNarrowEntries[i] = tableEntries[i] == Utility::INF ? NARROW_NO_PATH : (uint16_t)tableEntries[i];
+        }
+        narrowEntries = ownedNarrowEntries.data();
+    }
+    else
+    {
+        ownedWideEntries.resize(tableEntries.size());
+        for (size_t i = 0; i < tableEntries.size(); i++)
+        {
+            ownedWideEntries[i] = tableEntries[i] == Utility::INF ? WIDE_NO_PATH : (uint32_t)tableEntries[i];
+        }
+        wideEntries = ownedWideEntries.data();
+    }
+}
+
+SequenceTable::SequenceTable(int vertices, const void* mappedEntries)
+{
+    vertexCount = vertices;
+    if (GetEntryBytes(vertices) == sizeof(uint16_t))
+    {
+        narrowEntries = static_cast<const uint16_t*>(mappedEntries);
+    }
+    else
+    {
+        wideEntries = static_cast<const uint32_t*>(mappedEntries);
+    }
+}
+
+int SequenceTable::GetNextStop(int fromKey, int toKey) const
+{
+    size_t index = (size_t)fromKey * vertexCount + toKey;
+    if (narrowEntries)
+    {
+        uint16_t nextStop = narrowEntries[index];
+        return nextStop == NARROW_NO_PATH ? Utility::INF : nextStop;
+    }
+
+    uint32_t nextStop = wideEntries[index];
+    return nextStop == WIDE_NO_PATH ? Utility::INF : (int)nextStop;
+}
+
+int SequenceTable::GetVertexCount() const
+{
+    return vertexCount;
+}
+
+const void* SequenceTable::GetData() const
+{
+    if (narrowEntries)
+    {
+        return narrowEntries;
+    }
+    return wideEntries;
+}
+
+void SequenceTable::SetRow(int fromKey, const std::vector<int>& nextStops)
+{
+    size_t tableSize = (size_t)vertexCount * vertexCount;
+    if (narrowEntries && ownedNarrowEntries.empty())
+    {
+        ownedNarrowEntries.assign(narrowEntries, narrowEntries + tableSize);
+        narrowEntries = ownedNarrowEntries.data();
+    }
+    else if (wideEntries && ownedWideEntries.empty())
+    {
+        ownedWideEntries.assign(wideEntries, wideEntries + tableSize);
+        wideEntries = ownedWideEntries.data();
+    }
+
+    size_t rowStart = (size_t)fromKey * vertexCount;
+    for (int toKey = 0; toKey < vertexCount; toKey++)
+    {
+        if (narrowEntries)
+        {
+            ownedNarrowEntries[rowStart + toKey] = nextStops[toKey] == Utility::INF ? NARROW_NO_PATH : (uint16_t)nextStops[toKey];
+        }
+        else
+        {
+            ownedWideEntries[rowStart + toKey] = nextStops[toKey] == Utility::INF ? WIDE_NO_PATH : (uint32_t)nextStops[toKey];
+        }
+    }
+}
+
+void SequenceTable::InsertVertex(int vertexKey)
+{
+    // Rebuilt through the int form, the grown table may need the wider entry type.
+    int grownCount = vertexCount + 1;
+    std::vector<int> grownEntries((size_t)grownCount * grownCount, Utility::INF);
+    for (int fromKey = 0; fromKey < vertexCount; fromKey++)
+    {
+        size_t rowStart = (size_t)(fromKey < vertexKey ? fromKey : fromKey + 1) * grownCount;
+        for (int toKey = 0; toKey < vertexCount; toKey++)
+        {
+            int nextStop = GetNextStop(fromKey, toKey);
+            if (nextStop != Utility::INF && nextStop >= vertexKey)
+            {
+                nextStop++;
+            }
+            grownEntries[rowStart + (toKey < vertexKey ? toKey : toKey + 1)] = nextStop;
+        }
+    }
+
+    assign(grownCount, grownEntries);
+}
+
+size_t SequenceTable::GetEntryBytes(int vertices)
+{
+    // The largest key is vertices - 1, it has to stay below the no path marker.
+    return vertices < NARROW_NO_PATH ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+size_t SequenceTable::GetBytes() const
+{
+    return sizeof(SequenceTable) + ownedNarrowEntries.capacity() * sizeof(uint16_t) + ownedWideEntries.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <unordered_map>
+
+// Shortest paths over the departure graph from every departure leaving one station, built by the lazy engine the first time
+// the station is queried. parent holds the previous vertex on the shortest path to each vertex, -1 for the departures the
+// tree starts from and for vertices that can't be reached, distance holds Utility::INF for those that can't be reached.
+struct ShortestPathTree {
+    std::vector<int> distance;
+    std::vector<int> parent;
+    size_t GetBytes() const;
+};
+
+size_t ShortestPathTree::GetBytes() const
+{
+    return sizeof(ShortestPathTree) + (distance.capacity() + parent.capacity()) * sizeof(int);
+}
+
+// Least recently used trees, bounded by the bytes the trees hold. Lookups and inserts lock, so queries can run on several threads.
+// Trees are handed out as shared pointers, a tree evicted while a query is still walking it stays alive until the query is done.
+class ShortestPathTreeCache {
+    public:
+        // Key for a tree from stationID, twentyFourTime is negative when every departure of the station is a source.
+        static long long MakeKey(int stationID, bool includeLayovers, int twentyFourTime);
+        std::shared_ptr<const ShortestPathTree> Find(long long key);
+        // Keeps tree unless it alone is larger than the budget, evicting the least recently used trees until it fits.
+        // Returns the tree cached under key, which is an earlier one if another thread inserted it first.
+        std::shared_ptr<const ShortestPathTree> Insert(long long key, std::shared_ptr<const ShortestPathTree> tree);
+        // Drops every tree, used when the timetable changes.
+        void Clear();
+        // Bytes of the cached trees.
+        size_t GetBytes();
+        ShortestPathTreeCache(size_t budgetBytes);
+    private:
+        typedef std::pair<long long, std::shared_ptr<const ShortestPathTree>> Entry;
+        std::mutex cacheLock;
+        // Most recently used first.
+        std::list<Entry> entries;
+        std::unordered_map<long long, std::list<Entry>::iterator> entryByKey;
+        const size_t byteBudget;
+        size_t usedBytes;
+};
+
+ShortestPathTreeCache::ShortestPathTreeCache(size_t budgetBytes) : byteBudget(budgetBytes)
+{
+    usedBytes = 0;
+}
+
+long long ShortestPathTreeCache::MakeKey(int stationID, bool includeLayovers, int twentyFourTime)
+{
+    long long timeKey = twentyFourTime < 0 ? 0 : twentyFourTime + 1;
+    return ((long long)stationID << 32) | (timeKey << 1) | (includeLayovers ? 1 : 0);
+}
+
+std::shared_ptr<const ShortestPathTree> ShortestPathTreeCache::Find(long long key)
+{
+    std::lock_guard<std::mutex> guard(cacheLock);
+    auto entry = entryByKey.find(key);
+    if (entry == entryByKey.end())
+    {
+        return nullptr;
+    }
+
+    entries.splice(entries.begin(), entries, entry->second);
+    return entry->second->second;
+}
+
+void ShortestPathTreeCache::Clear()
+{
+    std::lock_guard<std::mutex> guard(cacheLock);
+    entries.clear();
+    entryByKey.clear();
+    usedBytes = 0;
+}
+
+std::shared_ptr<const ShortestPathTree> ShortestPathTreeCache::Insert(long long key, std::shared_ptr<const ShortestPathTree> tree)
+{
+    std::lock_guard<std::mutex> guard(cacheLock);
+    auto existing = entryByKey.find(key);
+    if (existing != entryByKey.end())
+    {
+        entries.splice(entries.begin(), entries, existing->second);
+        return existing->second->second;
+    }
+
+    size_t treeBytes = tree->GetBytes();
+    if (treeBytes > byteBudget)
+    {
+        return tree;
+    }
+
+    while (usedBytes + treeBytes > byteBudget)
+    {
+        usedBytes -= entries.back().second->GetBytes();
+        entryByKey.erase(entries.back().first);
+        entries.pop_back();
+    }
+
+    entries.push_front({key, tree});
+    entryByKey[key] = entries.begin();
+    usedBytes += treeBytes;
+    return tree;
+}
+
+size_t ShortestPathTreeCache::GetBytes()
+{
+    std::lock_guard<std::mutex> guard(cacheLock);
+    return usedBytes;
+}
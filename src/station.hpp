@@ -1,23 +1,30 @@
 #pragma once
-#include <vector>
 #include "trip.hpp"
 
+// Read-only view of one station's trips in the station or arrivals graph. It points into the graph's arrays instead of holding a
+// copy, so it is cheap to pass around but only valid until a runtime update (AddTrain, CancelTrain, DelayTrain) changes the graph.
 class Station {
     public:
         int GetID() const;
         int GetTripCount() const;
         Trip GetTrip(int tripIndex) const;
         bool StationIsValid() const;
-        Station(int ID, std::vector<Trip> tripArray);
+        Station(int ID, const int* destinationIDArray, const int* departureTimeArray, const int* arrivalTimeArray, int count);
     private:
-        std::vector<Trip> trips;
+        const int* destinationIDs;
+        const int* departureTimes;
+        const int* arrivalTimes;
+        int tripCount;
         int stationID;
 };
 
-Station::Station(int ID, std::vector<Trip> tripArray)
+Station::Station(int ID, const int* destinationIDArray, const int* departureTimeArray, const int* arrivalTimeArray, int count)
 {
-    trips = tripArray;
     stationID = ID;
+    destinationIDs = destinationIDArray;
+    departureTimes = departureTimeArray;
+    arrivalTimes = arrivalTimeArray;
+    tripCount = count;
 }
 
 bool Station::StationIsValid() const
@@ -27,12 +34,12 @@ bool Station::StationIsValid() const
 
 Trip Station::GetTrip(int tripIndex) const
 {
-    return trips[tripIndex];
+    return {destinationIDs[tripIndex], departureTimes[tripIndex], arrivalTimes[tripIndex]};
 }
 
 int Station::GetTripCount() const
 {
-    return trips.size();
+    return tripCount;
 }
 
 int Station::GetID() const
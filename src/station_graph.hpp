@@ -1,11 +1,30 @@
 #pragma once
 #include <vector>
 #include <queue>
+#include <memory>
+#include <shared_mutex>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+#include <map>
 #include "station.hpp"
 #include "departure.hpp"
 #include "route.hpp"
+#include "route_pattern.hpp"
+#include "min_plus_kernel.hpp"
+#include "sequence_table.hpp"
+#include "timetable_reader.hpp"
+#include "compiled_timetable.hpp"
+#include "shortest_path_tree_cache.hpp"
+#include "route_cache.hpp"
+#include "transfer_patterns.hpp"
+#include "reachability_index.hpp"
+#include "phase_profile.hpp"
+#include "memory_report.hpp"
+#include "departure_graph.hpp"
+#include "station_trip_table.hpp"
 
 /*
     Station graph has a few parts, all graphs are pre-computed as adjacency lists, but then converted to adjacency matrix format for
@@ -16,224 +35,514 @@
 
     The meat of processing happens with the departureGraphList, this graph maps all valid departures so that we can determine which are the shortest
     routes based on ride time only, or based on layover plus ride time. The graph creation is rather complex, but once processed, it enables much more
-    efficient look up operations.
+    efficient look up operations. Connections are found through per station departure lists sorted by time, so building it costs about
+    O(T log T) plus the number of edges. The graphs are stored in compressed sparse row form, one offsets array per graph and one
+    array per edge field, see departure_graph.hpp and station_trip_table.hpp.
 
-    see build_departures_graph and floyd_warshal_shortest_paths for the bulk of graph operations, also get_route paired with get_shortest_route.
+    see build_departures_graph and floyd_warshal_shortest_paths (min_plus_kernel.hpp) for the bulk of graph operations, also get_route paired with get_shortest_route.
+
+    The connection scan engine is an alternative to the pre-computed tables. It keeps every trip in a single array sorted by departure time
+    and answers each query with one backward scan over that array, so nothing quadratic or cubic is paid at construction.
+    see build_connections and connection_scan. The same scan answers departure window (profile) queries for every engine, see GetRouteProfile.
+
+    Route patterns group the trains of stationsGraphList by the station pair they run between. They back the round based (RAPTOR) query,
+    where round k finds the fastest arrivals using k trains, which gives the fastest itinerary for each number of transfers.
+    see build_route_patterns and raptor_rounds.
+
+    The Dijkstra engine also skips the tables. It runs a time dependent Dijkstra over the trains at query time, see time_dependent_dijkstra and
+    least_duration_dijkstra.
+    The departures of each station sorted by time are kept for every engine, they back the departure boards and let "leave at or after"
+    queries binary search for their first candidate, see build_station_departures and build_departure_key_index.
+
+    The lazy engine pre-computes nothing either. The first query from a station runs Dijkstra over the departure graph from every
+    departure leaving it, and the resulting tree answers every later query from that station. Trees are kept in a least recently
+    used cache bounded by a byte budget, see build_shortest_path_tree and shortest_path_tree_cache.hpp.
+
+    The transfer pattern engine keeps, for every pair of stations, the station sequences of the optimal journeys instead of every
+    departure pair. One backward connection scan per destination finds them for every origin at once, so building costs about
+    stations times the number of trains. A query then only tries the trains running between consecutive stations of each pattern,
+    see build_transfer_patterns and transfer_patterns.hpp.
+
+    PathExists and DirectPathExists are answered by bitsets over station pairs for every engine. The stations reachable from each
+    departure are merged in reverse topological order of the departure graph, see build_reachability_index.
+
+    Trains can be added, cancelled or delayed at runtime. An update rebuilds the lists of the stations the train touches and the
+    departure vertices whose edges change, then recomputes only the sequence table rows that could reach one of those vertices
+    before or after the change, see update_trip. Queries share the graph while updates hold it exclusively.
+
+    Any engine can put a route cache in front of GetShortestRoute and GetRouteFromTime. It keeps the trips of recent results so
+    popular station pairs skip the search and the route walk, see route_cache.hpp.
 */
 
+// Selects how route queries are answered, FloydWarshall pre-computes all pairs tables, ConnectionScan and Dijkstra compute each query on demand,
+// LazyTrees computes and caches the shortest paths from a station the first time it is queried, TransferPatterns pre-computes the
+// station sequences of optimal journeys and follows them at query time.
+enum class RouteEngine { FloydWarshall, ConnectionScan, Dijkstra, LazyTrees, TransferPatterns };
+
 class StationGraph{
     public:
-        StationGraph(std::vector<std::vector<std::string>> const tripData, std::vector<std::vector<std::string>> const stationData, int stationsCount);
+        // Bytes of shortest path trees the lazy engine keeps by default.
+        static const size_t DEFAULT_TREE_CACHE_BYTES = (size_t)256 << 20;
+        StationGraph(const std::vector<Connection>& tripData, const std::vector<StationRecord>& stationData, int stationsCount,
+            RouteEngine engine = RouteEngine::FloydWarshall, int precomputeThreads = 1, const CompiledTimetable* compiled = nullptr,
+            size_t treeCacheBytes = DEFAULT_TREE_CACHE_BYTES, size_t routeCacheEntries = 0);
         ~StationGraph();
         bool DirectPathExists(int station1ID, int station2ID);
         bool PathExists(int startStationID, int targetStationID);        
+        // Station and Departure are views into the graph, they stay valid until the next AddTrain, CancelTrain or DelayTrain.
         Station GetStationFromGraph(int stationID);
+        // Only the floyd warshal and lazy tree engines build the departure graph, the others throw.
         Departure GetDepartureFromGraph(int lookupKey);
+        bool HasDepartureGraph();
         Route GetShortestRoute(int departureStationID, int destinationStationID, bool includeLayovers);
+        // Earliest arriving itinerary leaving at or after twentyFourTime (HHMM as written), equal arrivals go to the later departure.
         Route GetRouteFromTime(int twentyFourTime, int departureStationID, int destinationStationID);
+        // The next count trains leaving stationID at or after twentyFourTime (HHMM as written), ordered by departure time.
+        std::vector<Connection> GetDepartureBoard(int stationID, int twentyFourTime, int count);
+        std::vector<Route> GetRoutesByTransfers(int departureStationID, int destinationStationID, int maxTransfers);
+        // Every itinerary leaving between windowStart and windowEnd (HHMM, inclusive) that no other itinerary beats on both departure
+        // and arrival time, ordered by departure time.
+        std::vector<Route> GetRouteProfile(int departureStationID, int destinationStationID, int windowStart, int windowEnd);
         Station GetStationFromArrivalGraph(int stationID);
         int GetVertexCount();
+        // Counters of the route cache, all zero when it is disabled.
+        RouteCacheStats GetRouteCacheStats();
+        // Time each construction step took, named after the function that ran it.
+        const PhaseProfile& GetBuildProfile() const;
+        // Bytes held by each graph, table and cache, with the peak working buffers of the table build as counts.
+        MemoryReport GetMemoryReport();
+        // Runtime timetable changes, each one is seen by every query that starts after it returns. Trains are numbered by lookUpKey,
+        // their line in trains.dat counting from 0, added trains are numbered after the last one.
+        // Returns the number of the new train, or -1 if a station or time is invalid.
+        int AddTrain(int departureStationID, int arrivalStationID, int departureTime, int arrivalTime);
+        bool CancelTrain(int trainNumber);
+        // Moves both times of a train by delayMinutes, which can be negative. Fails if the train would leave the day.
+        bool DelayTrain(int trainNumber, int delayMinutes);
+        // Writes the trips, departure graph and sequence tables to a compiled timetable, only valid with the FloydWarshall engine
+        // and before any runtime update.
+        void WriteCompiled(const std::string& path, const std::vector<StationRecord>& stationData, const std::vector<Connection>& tripData);
     private:
         const int stationCount;
+        const RouteEngine routeEngine;
+        // Number of threads floyd_warshal_shortest_paths splits each step across.
+        const int threadCount;
 
         // Station graph is a simple graph representing connections between stations by train routes.
         // this is used for easy schedule lookup, not used for route calculations.
-        std::vector<Station>* stationsGraphList;
+        StationTripTable* stationsGraphList = nullptr;
         // Arrivals graph is used in partnership with stations graph, it is inverted so that it maps trains arriving at a given station (vertex)
         // rather than leaving a given station. Used for printing schedules.
-        std::vector<Station>* stationArrivalsGraphList;
+        StationTripTable* stationArrivalsGraphList = nullptr;
 
         // Departure graph is used for the bulk of our calculations. It represents all possible valid routes by mapping
-        // departure times to the vertices and possible routes to the edges.
-        std::vector<Departure>* departureGraphList;
-        std::vector<std::vector<int>>* shortestRouteWithLayoverSequenceTable;
-        std::vector<std::vector<int>>* shortestRouteWithoutLayoverSequenceTable;
+        // departure times to the vertices and possible routes to the edges. Only built for the floyd warshal and lazy tree engines.
+        DepartureGraph* departureGraphList = nullptr;
+        // Every trip by lookUpKey, cancelled ones included so keys never change.
+        std::vector<Connection>* tripList = nullptr;
+        std::vector<bool>* cancelledTrips = nullptr;
+        bool timetableUpdated = false;
+        // Queries hold it shared, runtime updates exclusively.
+        std::shared_mutex graphLock;
+        PhaseProfile buildProfile;
+        // Largest distance and next hop buffers floyd_warshal_shortest_paths held at once, freed when it returns.
+        size_t floydWarshallWorkingBytes = 0;
+        // Keys of the departure vertices leaving each station ordered by departure time then key, indexed by station id - 1. Route
+        // lookups walk these instead of every vertex pair. Built along with the departure graph.
+        std::vector<std::vector<int>>* departureKeysByStation = nullptr;
+        SequenceTable* shortestRouteWithLayoverSequenceTable = nullptr;
+        SequenceTable* shortestRouteWithoutLayoverSequenceTable = nullptr;
+        // Every trip sorted by departure time, used by the connection scan engine and by profile queries.
+        std::vector<Connection>* connectionList = nullptr;
+        // Route patterns leaving each station, indexed by station id - 1 like stationsGraphList.
+        std::vector<std::vector<RoutePattern>>* routePatternList = nullptr;
+        // Trains leaving each station sorted by departure time, indexed by station id - 1. Used by the Dijkstra engine and departure boards.
+        std::vector<std::vector<Connection>>* stationDepartureList = nullptr;
+        // Shortest path trees from the stations queried so far, only used by the lazy engine.
+        ShortestPathTreeCache* shortestPathTreeCache = nullptr;
+        // Station sequences of the optimal journeys between each pair of stations, only used by the transfer pattern engine.
+        TransferPatternTable* transferPatternTable = nullptr;
+        // Stations reachable by any journey, and stations reachable by one train, from each station.
+        ReachabilityIndex* reachableStations = nullptr;
+        ReachabilityIndex* nonstopStations = nullptr;
+        // Results of recent GetShortestRoute and GetRouteFromTime queries, null when caching is disabled.
+        RouteCache* routeCache = nullptr;
         void floyd_warshal_shortest_paths(bool includeLayovers);
-        Route get_route(int departureKey, int destinationKey, const std::vector<std::vector<int>>& routeLookUpTable);
-        Route get_shortest_route(int departureID, int destinationID, const std::vector<std::vector<int>> &routeLookUpTable, bool includeLayovers);
+        Route get_route(int departureKey, int destinationKey, const SequenceTable& routeLookUpTable);
+        // Weight of the route get_route would give, without building its trip list. Utility::INF when it gives no route.
+        int get_route_weight(int departureKey, int destinationKey, const SequenceTable& routeLookUpTable, bool includeLayovers);
+        Route get_shortest_route(int departureID, int destinationID, const SequenceTable& routeLookUpTable, bool includeLayovers);
         Route get_shortest_route_from_time(int departureID, int destinationID, int twentyFourTime);
-        bool direct_route_exists(int departureID, int destinationID, const std::vector<std::vector<int>>& routeLookUpTable);
-        bool station_records_match(int Key1, int Key2, const std::vector<std::vector<std::string>>& tripDataTable);
-        void build_stations_graph(std::vector<std::vector<std::string>> tripData);
-        void build_station_arrivals_graph(std::vector<std::vector<std::string>> tripData);
-        void build_departures_graph(std::vector<std::vector<std::string>> tripData, std::vector<std::vector<std::string>> stationData);
+        void build_stations_graph(const std::vector<Connection>& tripData);
+        void build_station_arrivals_graph(const std::vector<Connection>& tripData);
+        StationTripTable* build_station_list(const std::vector<Connection>& tripData, bool byArrival);
+        void build_departures_graph(const std::vector<Connection>& tripData, const std::vector<StationRecord>& stationData);
+        void build_departure_key_index();
+        int get_terminal_key(int stationID);
+        void build_connections(const std::vector<Connection>& tripData);
+        void connection_scan(int destinationID, bool includeLayovers, std::vector<int>& bestValue, std::vector<int>& nextConnection);
+        Route get_shortest_route_by_scan(int departureID, int destinationID, bool includeLayovers, int twentyFourTime);
+        Route build_route(const std::vector<Connection>& legs, int destinationID);
+        void build_route_patterns(const std::vector<Connection>& tripData);
+        void raptor_rounds(int departureID, int destinationID, int twentyFourTime, int maxRounds, std::vector<std::vector<Connection>>& journeyByRound);
+        void build_station_departures(const std::vector<Connection>& tripData);
+        std::vector<Connection> time_dependent_dijkstra(int departureID, int destinationID, bool includeLayovers, int twentyFourTime);
+        std::vector<Connection> least_duration_dijkstra(int departureID, int destinationID);
+        Route get_shortest_route_by_dijkstra(int departureID, int destinationID, bool includeLayovers, int twentyFourTime);
+        std::shared_ptr<const ShortestPathTree> build_shortest_path_tree(int departureID, bool includeLayovers, int twentyFourTime);
+        std::shared_ptr<const ShortestPathTree> get_shortest_path_tree(int departureID, bool includeLayovers, int twentyFourTime);
+        Route get_shortest_route_by_tree(int departureID, int destinationID, bool includeLayovers, int twentyFourTime);
+        void build_transfer_patterns();
+        void add_transfer_patterns(int destinationID, const std::vector<char>& departureStations, std::vector<int>& bestValue,
+            std::vector<int>& nextConnection);
+        std::vector<int> topological_order();
+        void build_reachability_index();
+        const RoutePattern* find_route_pattern(int departureID, int destinationID);
+        std::vector<Connection> follow_transfer_pattern(const int* patternStations, int stationsInPattern, const Connection& firstTrip);
+        std::vector<Connection> least_ride_time_on_pattern(const int* patternStations, int stationsInPattern);
+        Route get_shortest_route_by_patterns(int departureID, int destinationID, bool includeLayovers, int twentyFourTime);
+        Route find_shortest_route(int departureID, int destinationID, bool includeLayovers);
+        Route find_route_from_time(int twentyFourTime, int departureID, int destinationID);
+        // Fills in the stops of a found route, called by the public queries while they still hold graphLock.
+        void add_route_stops(Route& tripRoute);
+        static int shift_time(int twentyFourTime, int minutes);
+        void add_to_route_patterns(const Connection& trip);
+        void update_trip(int lookUpKey, const Connection* previousRecord);
+        void insert_trip_vertex(int lookUpKey);
+        void update_station_lists(int lookUpKey, const Connection* previousRecord);
+        void collect_changed_departures(const Connection& record, std::vector<int>& changedKeys);
+        std::vector<TripPlusLayover> build_departure(int lookUpKey);
+        int get_last_matching_key(const Connection& record);
+        void collect_route_ancestors(const std::vector<int>& keys, std::vector<char>& isAncestor);
+        void collect_stations_reaching(const std::vector<std::pair<int, int>>& targets, std::vector<char>& isReaching);
+        void collect_stations_reached(const std::vector<std::pair<int, int>>& sources, std::vector<char>& isReached);
+        void repair_reachability_rows(const std::vector<char>& affectedStations);
+        void repair_sequence_rows(const std::vector<char>& affectedRows);
+        Route get_cached_route(const RouteCacheKey& key);
 };
 
-StationGraph::StationGraph(std::vector<std::vector<std::string>> const tripDataTable, std::vector<std::vector<std::string>> const stationDataTable, int stationsCount) : stationCount(stationsCount)
+StationGraph::StationGraph(const std::vector<Connection>& tripDataTable, const std::vector<StationRecord>& stationDataTable, int stationsCount,
+    RouteEngine engine, int precomputeThreads, const CompiledTimetable* compiled, size_t treeCacheBytes, size_t routeCacheEntries)
+    : stationCount(stationsCount), routeEngine(engine), threadCount(precomputeThreads)
 {
-    build_stations_graph(tripDataTable);
-    build_station_arrivals_graph(tripDataTable);
-    build_departures_graph(tripDataTable, stationDataTable);
+    tripList = new std::vector<Connection>(tripDataTable);
+    cancelledTrips = new std::vector<bool>(tripDataTable.size(), false);
+    buildProfile.Time("build_stations_graph", [&] { build_stations_graph(tripDataTable); });
+    buildProfile.Time("build_station_arrivals_graph", [&] { build_station_arrivals_graph(tripDataTable); });
+
+    // A compiled timetable already holds the departure graph and the sequence tables, they are loaded rather than rebuilt.
+    if (compiled)
+    {
+        buildProfile.Time("read_compiled_departures", [&]
+        {
+            departureGraphList = new DepartureGraph;
+            compiled->ReadDepartures(*departureGraphList);
+        });
+    }
+    else if (routeEngine == RouteEngine::FloydWarshall || routeEngine == RouteEngine::LazyTrees)
+    {
+        buildProfile.Time("build_departures_graph", [&] { build_departures_graph(tripDataTable, stationDataTable); });
+    }
+    // The other engines search the connections and station departures, their routes use the same trip and terminal keys without
+    // the graph, which grows with the square of the trains leaving busy stations.
+    if (departureGraphList)
+    {
+        buildProfile.AddCount("departure_graph_vertices", departureGraphList->GetVertexCount());
+        buildProfile.AddCount("departure_graph_edges", departureGraphList->GetEdgeCount());
+        buildProfile.Time("build_departure_key_index", [&] { build_departure_key_index(); });
+    }
+    buildProfile.Time("build_route_patterns", [&] { build_route_patterns(tripDataTable); });
+    buildProfile.Time("build_connections", [&] { build_connections(tripDataTable); });
+    buildProfile.Time("build_station_departures", [&] { build_station_departures(tripDataTable); });
+    buildProfile.Time("build_reachability_index", [&] { build_reachability_index(); });
+
+    if (routeEngine == RouteEngine::ConnectionScan)
+    {
+        // Only needs the sorted connections, no tables are pre-computed.
+    }
+    else if (routeEngine == RouteEngine::Dijkstra)
+    {
+        // Only needs the sorted station departures.
+    }
+    else if (routeEngine == RouteEngine::LazyTrees)
+    {
+        shortestPathTreeCache = new ShortestPathTreeCache(treeCacheBytes);
+    }
+    else if (routeEngine == RouteEngine::TransferPatterns)
+    {
+        buildProfile.Time("build_transfer_patterns", [&] { build_transfer_patterns(); });
+    }
+    else if (compiled)
+    {
+        // Tables are read straight from the mapping, pages are only loaded when a route walks them.
+        shortestRouteWithLayoverSequenceTable = new SequenceTable(compiled->GetVertexCount(), compiled->GetSequenceTableData(true));
+        shortestRouteWithoutLayoverSequenceTable = new SequenceTable(compiled->GetVertexCount(), compiled->GetSequenceTableData(false));
+    }
+    else
+    {
+        // Build shortest path lookup table for both including layovers, and for not including layvoers.
+        buildProfile.Time("floyd_warshal_shortest_paths_with_layovers", [&] { floyd_warshal_shortest_paths(true); });
+        buildProfile.Time("floyd_warshal_shortest_paths_without_layovers", [&] { floyd_warshal_shortest_paths(false); });
+    }
 
-    // Build shortest path lookup table for both including layovers, and for not including layvoers.
-    floyd_warshal_shortest_paths(true);
-    floyd_warshal_shortest_paths(false);
+    if (routeCacheEntries > 0)
+    {
+        routeCache = new RouteCache(routeCacheEntries);
+    }
 }
 
 StationGraph::~StationGraph()
 {
+    if(tripList) delete tripList;
+    if(cancelledTrips) delete cancelledTrips;
     if(stationsGraphList) delete stationsGraphList;
     if(stationArrivalsGraphList) delete stationArrivalsGraphList;
     if(departureGraphList) delete departureGraphList;
+    if(departureKeysByStation) delete departureKeysByStation;
     if(shortestRouteWithLayoverSequenceTable) delete shortestRouteWithLayoverSequenceTable;
     if(shortestRouteWithoutLayoverSequenceTable) delete shortestRouteWithoutLayoverSequenceTable;
+    if(connectionList) delete connectionList;
+    if(routePatternList) delete routePatternList;
+    if(stationDepartureList) delete stationDepartureList;
+    if(shortestPathTreeCache) delete shortestPathTreeCache;
+    if(transferPatternTable) delete transferPatternTable;
+    if(reachableStations) delete reachableStations;
+    if(nonstopStations) delete nonstopStations;
+    if(routeCache) delete routeCache;
 }
 
-void StationGraph::build_stations_graph(std::vector<std::vector<std::string>> tripDataTable)
+void StationGraph::build_stations_graph(const std::vector<Connection>& tripDataTable)
 {
-    // Use a temporary table to hold all trips so that they
-    // can be passed into station constructor.
-    // We don't want to allow the addition of new graph elements after construction because we are pre-computing shortest paths
-    // so not making any public functions to add nodes or edges.
-    stationsGraphList = new std::vector<Station>;
+    // AddTrain, CancelTrain and DelayTrain patch these lists after construction, update_trip keeps the departure graph, sequence
+    // tables and reachability in step with them.
+    stationsGraphList = build_station_list(tripDataTable, false);
+}
 
-    std::vector<std::vector<Trip>> tempTripTable;
-    for(int i = 0; i < stationCount; i++)
+// Stations with the trips leaving them, or with the trips arriving at them inverted when byArrival is set, ordered by departure time
+// (the arrival time in the inverted lists) so schedules print in order.
+StationTripTable* StationGraph::build_station_list(const std::vector<Connection>& tripDataTable, bool byArrival)
+{
+    // Trips are bucketed by station into one temporary table, counted first so each station's trips end up next to each other.
+    std::vector<int> stationOffsets(stationCount + 1, 0);
+    for (const Connection& trip : tripDataTable)
     {
-        tempTripTable.push_back({});
+        stationOffsets[byArrival ? trip.arrivalStationID : trip.departureStationID]++;
     }
-
-    //Add the trip data to tempTripTable array
-    for(int i = 0; i < tripDataTable.size(); i++)
+    for (int i = 0; i < stationCount; i++)
     {
-        int startID = stoi(tripDataTable[i][0]) - 1;
-        int destinationID = stoi(tripDataTable[i][1]);
-        int arrivalTime = stoi(tripDataTable[i][3]);
-        int departureTime = stoi(tripDataTable[i][2]);
-        tempTripTable[startID].push_back({destinationID, departureTime, arrivalTime});
+        stationOffsets[i + 1] += stationOffsets[i];
     }
 
-    //Construct the stations and add trips to graph.
-    for(int i = 0; i < stationCount; i++)
+    std::vector<Trip> tempTripTable(tripDataTable.size());
+    std::vector<int> nextSlot(stationOffsets.begin(), stationOffsets.end() - 1);
+    for (const Connection& trip : tripDataTable)
     {
-        stationsGraphList->push_back({i + 1, tempTripTable[i]});
+        if (byArrival)
+        {
+            tempTripTable[nextSlot[trip.arrivalStationID - 1]++] = {trip.departureStationID, trip.arrivalTime, trip.departureTime};
+        }
+        else
+        {
+            tempTripTable[nextSlot[trip.departureStationID - 1]++] = {trip.arrivalStationID, trip.departureTime, trip.arrivalTime};
+        }
     }
-}
 
-bool StationGraph::station_records_match(int Key1, int Key2, const std::vector<std::vector<std::string>>& tripDataTable)
-{
-    return (stoi(tripDataTable[Key1][0]) == stoi(tripDataTable[Key2][0])
-        && stoi(tripDataTable[Key1][1]) == stoi(tripDataTable[Key2][1])
-        && stoi(tripDataTable[Key1][2]) == stoi(tripDataTable[Key2][2])
-        && stoi(tripDataTable[Key1][3]) == stoi(tripDataTable[Key2][3]));
+    StationTripTable* stations = new StationTripTable;
+    stations->Reserve(stationCount, tempTripTable.size());
+    for (int i = 0; i < stationCount; i++)
+    {
+        Trip* first = tempTripTable.data() + stationOffsets[i];
+        Trip* last = tempTripTable.data() + stationOffsets[i + 1];
+        std::stable_sort(first, last, [](const Trip& a, const Trip& b) { return a.departureTime < b.departureTime; });
+        stations->AddStation(first, last - first);
+    }
+    return stations;
 }
 
-void StationGraph::build_departures_graph(std::vector<std::vector<std::string>> tripDataTable, std::vector<std::vector<std::string>> stationDataTable)
+void StationGraph::build_departures_graph(const std::vector<Connection>& trips, const std::vector<StationRecord>& stationDataTable)
 {
-    departureGraphList = new std::vector<Departure>;
-    std::vector<std::pair<std::pair<int, int>, std::vector<TripPlusLayover>>> tempTripTable; 
+    departureGraphList = new DepartureGraph;
+    const int tripCount = trips.size();
 
-    for(int i = 0; i < tripDataTable.size(); i++)
+    // Identical records are grouped together by sorting, stable so each group stays in file order. Every vertex of a group gets the
+    // edges of all records in the group, and edges into a group always point at its last record.
+    auto recordLess = [&trips](int a, int b)
+    {
+        return std::tie(trips[a].departureStationID, trips[a].arrivalStationID, trips[a].departureTime, trips[a].arrivalTime) <
+            std::tie(trips[b].departureStationID, trips[b].arrivalStationID, trips[b].departureTime, trips[b].arrivalTime);
+    };
+    std::vector<int> recordOrder(tripCount);
+    for (int i = 0; i < tripCount; i++)
     {
-        tempTripTable.push_back({});
+        recordOrder[i] = i;
     }
+    std::stable_sort(recordOrder.begin(), recordOrder.end(), recordLess);
 
-    for(int i = 0; i < tripDataTable.size(); i++)
-    {        
-        int destinationKey;
-        int departureTime = stoi(tripDataTable[i][2]);
-        int rideTimeToDestination = stoi(tripDataTable[i][3]) - stoi(tripDataTable[i][2]);
-        int layoverAtDestination = 0; // this node marks end of trip, no layover added.
-        int totalTripTime = rideTimeToDestination + layoverAtDestination;
-
-        // Map trip target station id to the lookUpKey of the vertex.
-        for(int keyIndx = 0; keyIndx < tripDataTable.size(); keyIndx++)
+    std::vector<std::pair<int, int>> recordGroups;
+    std::vector<int> lastMatchingKey(tripCount);
+    std::vector<int> groupOfKey(tripCount);
+    for (int groupBegin = 0, groupEnd = 0; groupBegin < tripCount; groupBegin = groupEnd)
+    {
+        groupEnd = groupBegin + 1;
+        while (groupEnd < tripCount && !recordLess(recordOrder[groupBegin], recordOrder[groupEnd]))
         {
-            if(station_records_match(keyIndx, i, tripDataTable))
-            {   
-                // Map terminating destinations to the appropriate keys at the end of the look up table.             
-                destinationKey = stoi(tripDataTable[keyIndx][1]) + (tripDataTable.size() - 1);
-            }
+            groupEnd++;
         }
 
-        for(int k = 0; k < tripDataTable.size(); k++)
+        for (int m = groupBegin; m < groupEnd; m++)
         {
-            //If the target edge departure time and departure station match, this is the correct insertion point, add edge to adjacency list.
-            if(station_records_match(k, i, tripDataTable))
-            {
-                tempTripTable[k].first.first = departureTime;
-                tempTripTable[k].first.second = stoi(tripDataTable[i][0]);
-                tempTripTable[k].second.push_back({destinationKey, rideTimeToDestination, layoverAtDestination, totalTripTime});                
-            }
+            lastMatchingKey[recordOrder[m]] = recordOrder[groupEnd - 1];
+            groupOfKey[recordOrder[m]] = recordGroups.size();
         }
-        
-        for(int j = 0; j < tripDataTable.size(); j++)
-        {                        
-            if(j != i && tripDataTable[i][1] == tripDataTable[j][0] && tripDataTable[i][3] < tripDataTable[j][2])
-            {
-                departureTime = stoi(tripDataTable[i][2]);
-                rideTimeToDestination = stoi(tripDataTable[i][3]) - stoi(tripDataTable[i][2]);
-                layoverAtDestination = stoi(tripDataTable[j][2]) - stoi(tripDataTable[i][3]);
-                totalTripTime = rideTimeToDestination + layoverAtDestination;
+        recordGroups.push_back({groupBegin, groupEnd});
+    }
 
-                // Map trip ID to its corresponding key value for easy look up.
-                for (int keyIndx = 0; keyIndx < tripDataTable.size(); keyIndx++)
-                {
-                    if (station_records_match(keyIndx, j, tripDataTable))
-                    {
-                        destinationKey = keyIndx;
-                    }
-                }
+    // Trains leaving each station sorted by departure time, the connections of a trip are a suffix of its arrival station's list.
+    std::unordered_map<int, std::vector<int>> departuresByStation;
+    for (int i = 0; i < tripCount; i++)
+    {
+        departuresByStation[trips[i].departureStationID].push_back(i);
+    }
+    for (auto& station : departuresByStation)
+    {
+        std::stable_sort(station.second.begin(), station.second.end(),
+            [&trips](int a, int b) { return trips[a].departureTime < trips[b].departureTime; });
+    }
+
+    // Every record of a group gets the edges of all its records, in group order.
+    std::vector<int> connectingTrips;
+    auto collectGroupEdges = [&](const std::pair<int, int>& group, std::vector<TripPlusLayover>& groupEdges)
+    {
+        for (int m = group.first; m < group.second; m++)
+        {
+            const Connection& trip = trips[recordOrder[m]];
+            int rideTimeToDestination = trip.arrivalTime - trip.departureTime;
+
+            // Map terminating destinations to the appropriate keys at the end of the look up table, this node marks end of trip, no layover added.
+            groupEdges.push_back({trip.arrivalStationID + (tripCount - 1), rideTimeToDestination, 0, rideTimeToDestination});
 
-                // Search adjacency list for matching vertex to insert new edge data. Can't be a simple index with current setup.
-                // This is the only time this search must happen because when the graph is created, each departure is assigned a lookupKey that can be used
-                // to index the list and match the vertex.
-                for (int k = 0; k < tripDataTable.size(); k++)
+            connectingTrips.clear();
+            auto station = departuresByStation.find(trip.arrivalStationID);
+            if (station != departuresByStation.end())
+            {
+                auto firstConnection = std::partition_point(station->second.begin(), station->second.end(),
+                    [&trips, &trip](int j) { return trips[j].departureTime <= trip.arrivalTime; });
+                for (auto j = firstConnection; j != station->second.end(); j++)
                 {
-                    //If the target edge departure time and departure station match, this is the correct insertion point, add edge to adjacency list.
-                    if (station_records_match(k, i, tripDataTable))
+                    if (*j != trip.lookUpKey)
                     {
-                        tempTripTable[k].first.first = departureTime;
-                        tempTripTable[k].first.second = stoi(tripDataTable[i][0]);
-                        tempTripTable[k].second.push_back({destinationKey, rideTimeToDestination, layoverAtDestination, totalTripTime});
+                        connectingTrips.push_back(*j);
                     }
                 }
             }
+
+            // Edges are listed in file order of the connecting trip.
+            std::sort(connectingTrips.begin(), connectingTrips.end());
+            for (int j : connectingTrips)
+            {
+                int layoverAtDestination = trips[j].departureTime - trip.arrivalTime;
+                groupEdges.push_back({lastMatchingKey[j], rideTimeToDestination, layoverAtDestination, rideTimeToDestination + layoverAtDestination});
+            }
+        }
+    };
+
+    // Edges are counted first so the graph arrays are sized exactly. A record adds one edge to the terminal vertex and one per
+    // connecting trip, the trip itself is only among those if it leaves its arrival station after arriving there.
+    size_t edgeCount = 0;
+    for (const std::pair<int, int>& group : recordGroups)
+    {
+        size_t groupEdgeCount = 0;
+        for (int m = group.first; m < group.second; m++)
+        {
+            const Connection& trip = trips[recordOrder[m]];
+            groupEdgeCount++;
+            auto station = departuresByStation.find(trip.arrivalStationID);
+            if (station != departuresByStation.end())
+            {
+                groupEdgeCount += station->second.end() - std::partition_point(station->second.begin(), station->second.end(),
+                    [&trips, &trip](int j) { return trips[j].departureTime <= trip.arrivalTime; });
+                groupEdgeCount -= trip.departureStationID == trip.arrivalStationID && trip.departureTime > trip.arrivalTime;
+            }
         }
+        edgeCount += groupEdgeCount * (group.second - group.first);
     }
+    departureGraphList->Reserve(tripCount + stationDataTable.size(), edgeCount);
 
-    // Populate the departure graph using data from tempTripTable.
-    for(int i = 0; i < tempTripTable.size(); i++)
+    // Vertices are added in key order. Most groups hold one record, their edges go through one reused buffer. The edges of larger
+    // groups are kept from their first record until their last, the highest key.
+    std::vector<TripPlusLayover> tempTripTable;
+    std::unordered_map<int, std::vector<TripPlusLayover>> sharedGroupEdges;
+    for (int i = 0; i < tripCount; i++)
     {
-        departureGraphList->push_back({tempTripTable[i].second, tempTripTable[i].first.second, i, tempTripTable[i].first.first});
+        const std::pair<int, int>& group = recordGroups[groupOfKey[i]];
+        const std::vector<TripPlusLayover>* edges = &tempTripTable;
+        if (group.second - group.first == 1)
+        {
+            tempTripTable.clear();
+            collectGroupEdges(group, tempTripTable);
+        }
+        else
+        {
+            auto shared = sharedGroupEdges.try_emplace(groupOfKey[i]);
+            if (shared.second)
+            {
+                collectGroupEdges(group, shared.first->second);
+            }
+            edges = &shared.first->second;
+        }
+
+        departureGraphList->AddVertex(trips[i].departureStationID, trips[i].departureTime, edges->data(), edges->size());
+        if (group.second - group.first > 1 && i == recordOrder[group.second - 1])
+        {
+            sharedGroupEdges.erase(groupOfKey[i]);
+        }
     }
 
     // Populate terminating arrival nodes, required for shortest path algortithm
-    for(int i = 0; i < stationDataTable.size(); i++)
+    for (int i = 0; i < stationDataTable.size(); i++)
     {
-       departureGraphList->push_back({{}, stoi(stationDataTable[i][0]), i + (int)tempTripTable.size(), 0});     
+       departureGraphList->AddVertex(stationDataTable[i].stationID, 0, nullptr, 0);
     }
 }
 
-void StationGraph::build_station_arrivals_graph(std::vector<std::vector<std::string>> tripDataTable)
+void StationGraph::build_departure_key_index()
 {
-    stationArrivalsGraphList = new std::vector<Station>;
-
-    std::vector<std::vector<Trip>> tempTripTable;
-    for(int i = 0; i < stationCount; i++)
+    departureKeysByStation = new std::vector<std::vector<int>>(stationCount);
+    int tripCount = (int)departureGraphList->GetVertexCount() - stationCount;
+    for (int i = 0; i < tripCount; i++)
     {
-        tempTripTable.push_back({});
+        int iDAsZeroIndex = departureGraphList->GetStationID(i) - 1;
+        if (iDAsZeroIndex >= 0 && iDAsZeroIndex < stationCount)
+        {
+            (*departureKeysByStation)[iDAsZeroIndex].push_back(i);
+        }
     }
 
-    //Add the trip data to tempTripTable array
-    for(int i = 0; i < tripDataTable.size(); i++)
+    // Keys went in ascending, a stable sort keeps them that way within a departure time.
+    for (std::vector<int>& departureKeys : *departureKeysByStation)
     {
-        int startID = stoi(tripDataTable[i][1]) - 1;
-        int destinationID = stoi(tripDataTable[i][0]);
-        int arrivalTime = stoi(tripDataTable[i][2]);
-        int departureTime = stoi(tripDataTable[i][3]);
-        tempTripTable[startID].push_back({destinationID, departureTime, arrivalTime});
+        std::stable_sort(departureKeys.begin(), departureKeys.end(),
+            [this](int a, int b) { return departureGraphList->GetDepartureTime(a) < departureGraphList->GetDepartureTime(b); });
     }
+}
 
-    //Construct the stations and add trips to graph.
-    for(int i = 0; i < stationCount; i++)
-    {
-        stationArrivalsGraphList->push_back({i + 1, tempTripTable[i]});
-    }
+int StationGraph::get_terminal_key(int stationID)
+{
+    // Terminal vertices follow the trip vertices in station order, see build_departures_graph.
+    return (int)tripList->size() + stationID - 1;
+}
+
+void StationGraph::build_station_arrivals_graph(const std::vector<Connection>& tripDataTable)
+{
+    stationArrivalsGraphList = build_station_list(tripDataTable, true);
 }
 
-Route StationGraph::get_route(int departureKey, int destinationKey, const std::vector<std::vector<int>>& routeLookUpTable)
+Route StationGraph::get_route(int departureKey, int destinationKey, const SequenceTable& routeLookUpTable)
 {        
+    if (departureGraphList->IsFinalDestination(departureKey))
+    {
+        return {-1, {}};
+    }
+
     std::vector<TripPlusLayover> shortPath;
     
     int nextStopID = departureKey;
@@ -241,25 +550,25 @@ Route StationGraph::get_route(int departureKey, int destinationKey, const std::v
 
     while(!endOfPath)
     {
-        Departure currentNode = (*departureGraphList)[nextStopID];
-        nextStopID = routeLookUpTable[nextStopID][destinationKey];
+        int currentKey = nextStopID;
+        nextStopID = routeLookUpTable.GetNextStop(currentKey, destinationKey);
 
-        if (currentNode.IsFinalDestination() || nextStopID == Utility::INF)
+        if (departureGraphList->IsFinalDestination(currentKey) || nextStopID == Utility::INF)
         {
             if(nextStopID != Utility::INF)
             {
-                shortPath.push_back(currentNode.FindTripByDestinationKey(nextStopID));
+                shortPath.push_back(departureGraphList->FindEdge(currentKey, nextStopID));
             }
             endOfPath = true;
         }
         else
         {
-            TripPlusLayover nextTrip = currentNode.FindTripByDestinationKey(nextStopID);
+            TripPlusLayover nextTrip = departureGraphList->FindEdge(currentKey, nextStopID);
             shortPath.push_back(nextTrip);
         }
     }
 
-    Route finalRoute{(*departureGraphList)[departureKey], shortPath};
+    Route finalRoute{departureKey, shortPath};
 
     if(finalRoute.RouteIsValid())
     {        
@@ -267,250 +576,2028 @@ Route StationGraph::get_route(int departureKey, int destinationKey, const std::v
     }
     else
     {        
-        return{{{}, -1, -1, -1} ,{}};
+        return{-1, {}};
     }            
 }
-bool StationGraph::direct_route_exists(int departureID, int destinationID, const std::vector<std::vector<int>>& routeLookUpTable)
+// Same walk as get_route, summing the weights instead of copying the trips, so comparing candidate departures allocates nothing.
+int StationGraph::get_route_weight(int departureKey, int destinationKey, const SequenceTable& routeLookUpTable, bool includeLayovers)
 {
-    std::vector<Route> potentialRouteList;
+    if (departureGraphList->IsFinalDestination(departureKey))
+    {
+        return Utility::INF;
+    }
 
-    for (int j = 0; j < departureGraphList->size(); j++)
+    int totalWeight = 0;
+    int hopCount = 0;
+    int currentKey = departureKey;
+    int nextStopID = routeLookUpTable.GetNextStop(currentKey, destinationKey);
+    while (nextStopID != Utility::INF)
     {
-        for (int k = 0; k < departureGraphList->size(); k++)
+        TripPlusLayover nextTrip = departureGraphList->FindEdge(currentKey, nextStopID);
+        totalWeight += includeLayovers ? nextTrip.tripWeight : nextTrip.rideTimeToDestinationMins;
+        hopCount++;
+        if (departureGraphList->IsFinalDestination(nextStopID))
         {
-            if ((*departureGraphList)[j].GetStationID() == departureID && (*departureGraphList)[k].GetStationID() == destinationID)
-            {
-                Route potentialRoute = get_route(j, k, routeLookUpTable);
-                if (potentialRoute.RouteIsValid())
-                {
-                    if(potentialRoute.tripList.size() == 1)
-                    {
-                        return true;
-                    }
-                }
-            }
+            break;
         }
+        currentKey = nextStopID;
+        nextStopID = routeLookUpTable.GetNextStop(currentKey, destinationKey);
     }
 
-    return false;
+    return hopCount > 0 ? totalWeight : Utility::INF;
 }
-Route StationGraph::get_shortest_route(int departureID, int destinationID, const std::vector<std::vector<int>> &routeLookUpTable, bool includeLayovers)
-{
-    std::vector<Route> potentialRouteList;
 
-    for (int j = 0; j < departureGraphList->size(); j++)
+Route StationGraph::get_shortest_route(int departureID, int destinationID, const SequenceTable& routeLookUpTable, bool includeLayovers)
+{
+    // Only the weights are compared, the lowest departure key wins among equal weights and only its route is built.
+    int destinationKey = get_terminal_key(destinationID);
+    int minimumWeight = Utility::INF;
+    int shortestKey = -1;
+    for (int departureKey : (*departureKeysByStation)[departureID - 1])
     {
-        for (int k = 0; k < departureGraphList->size(); k++)
+        int totalCurrentWeight = get_route_weight(departureKey, destinationKey, routeLookUpTable, includeLayovers);
+        if (totalCurrentWeight == Utility::INF)
         {
-            if ((*departureGraphList)[j].GetStationID() == departureID && (*departureGraphList)[k].GetStationID() == destinationID)
-            {
-                Route potentialRoute = get_route(j, k, routeLookUpTable);
-                if (potentialRoute.RouteIsValid())
-                {
-                    potentialRouteList.push_back(potentialRoute);
-                }
-            }
+            continue;
         }
-    }
 
-    if (potentialRouteList.size() > 0)
-    {
-        //Determine which route is shortest and return it.
-        int minimumWeight = Utility::INF;
-        int shortestRouteIndex = -1;
-        for (int i = 0; i < potentialRouteList.size(); i++)
+        if (totalCurrentWeight < minimumWeight || (totalCurrentWeight == minimumWeight && departureKey < shortestKey))
         {
-            int totalCurrentWeight = 0;
-            for (int j = 0; j < potentialRouteList[i].tripList.size(); j++)
-            {
-                TripPlusLayover currentTrip = potentialRouteList[i].tripList[j];
-                totalCurrentWeight += includeLayovers? currentTrip.tripWeight : currentTrip.rideTimeToDestinationMins;
-            }
-
-            if (totalCurrentWeight < minimumWeight)
-            {
-                minimumWeight = totalCurrentWeight;
-                totalCurrentWeight = 0;
-                shortestRouteIndex = i;
-            }
+            minimumWeight = totalCurrentWeight;
+            shortestKey = departureKey;
         }
-
-        return potentialRouteList[shortestRouteIndex];
     }
-    else
+
+    if (shortestKey == -1)
     {
-        return {{{}, -1, -1, -1}, {}};
+        return {-1, {}};
     }
+    return get_route(shortestKey, destinationKey, routeLookUpTable);
 }
 
 Route StationGraph::get_shortest_route_from_time(int departureID, int destinationID, int twentyFourTime)
 {
-    std::vector<Route> potentialRouteList;
+    int destinationKey = get_terminal_key(destinationID);
+    int earliestArrival = Utility::INF;
+    int latestDeparture = -1;
+    int shortestKey = -1;
 
-    for (int j = 0; j < departureGraphList->size(); j++)
+    // Keys are ordered by departure time, the walk starts at the first one leaving at or after the requested time.
+    const std::vector<int>& departureKeys = (*departureKeysByStation)[departureID - 1];
+    auto firstKey = std::partition_point(departureKeys.begin(), departureKeys.end(),
+        [this, twentyFourTime](int key) { return departureGraphList->GetDepartureTime(key) < twentyFourTime; });
+    for (auto departureKey = firstKey; departureKey != departureKeys.end(); departureKey++)
     {
-        for (int k = 0; k < departureGraphList->size(); k++)
+        // Nothing leaving after the best arrival so far can arrive earlier.
+        int departureTime = departureGraphList->GetDepartureTime(*departureKey);
+        if (departureTime > earliestArrival)
         {
-            if ((*departureGraphList)[j].GetStationID() == departureID && (*departureGraphList)[k].GetStationID() == destinationID)
-            {
-                Route potentialRoute = get_route(j, k, *shortestRouteWithLayoverSequenceTable);
-                if (potentialRoute.RouteIsValid() && (potentialRoute.departingStation.GetDepartureTime() == twentyFourTime ||
-                potentialRoute.departingStation.GetDepartureTime() == twentyFourTime - 1200))
-                {
-                    potentialRouteList.push_back(potentialRoute);
-                }
-            }
+            break;
         }
-    }
 
-    if (potentialRouteList.size() > 0)
-    {
-        //Determine which route is shortest and return it.
-        int minimumWeight = Utility::INF;
-        int shortestRouteIndex = -1;
-        for (int i = 0; i < potentialRouteList.size(); i++)
+        int routeWeight = get_route_weight(*departureKey, destinationKey, *shortestRouteWithLayoverSequenceTable, true);
+        if (routeWeight == Utility::INF)
         {
-            int totalCurrentWeight = 0;
-            for (int j = 0; j < potentialRouteList[i].tripList.size(); j++)
-            {
-                TripPlusLayover currentTrip = potentialRouteList[i].tripList[j];
-                totalCurrentWeight += currentTrip.tripWeight;
-            }
-
-            if (totalCurrentWeight < minimumWeight)
-            {
-                minimumWeight = totalCurrentWeight;
-                totalCurrentWeight = 0;
-                shortestRouteIndex = i;
-            }
+            continue;
         }
 
-        return potentialRouteList[shortestRouteIndex];
+        // Overall travel time telescopes to the final arrival minus the departure.
+        int arrivalTime = departureTime + routeWeight;
+        if (arrivalTime < earliestArrival || (arrivalTime == earliestArrival && departureTime > latestDeparture))
+        {
+            earliestArrival = arrivalTime;
+            latestDeparture = departureTime;
+            shortestKey = *departureKey;
+        }
     }
-    else
+
+    if (shortestKey == -1)
     {
-        return {{{}, -1, -1, -1}, {}};
+        return {-1, {}};
     }
+    return get_route(shortestKey, destinationKey, *shortestRouteWithLayoverSequenceTable);
 }
 
-void StationGraph::floyd_warshal_shortest_paths(bool includeLayovers)
+void StationGraph::build_connections(const std::vector<Connection>& tripDataTable)
+{
+    connectionList = new std::vector<Connection>(tripDataTable);
+
+    // Stable sort keeps file order for trains leaving at the same time.
+    std::stable_sort(connectionList->begin(), connectionList->end(),
+        [](const Connection& a, const Connection& b) { return a.departureTime < b.departureTime; });
+}
+
+// Walks the connections from the latest departure to the earliest. For every connection bestValue ends up holding the earliest arrival at
+// the destination (or the least riding time when layovers are not included) for a passenger already on that train, and nextConnection
+// the train to change to, -1 meaning get off at the destination.
+void StationGraph::connection_scan(int destinationID, bool includeLayovers, std::vector<int>& bestValue, std::vector<int>& nextConnection)
 {
-    // number of table entries will be the larger of station count and size of graph list.
     const int INF = Utility::INF;
-    // Construct adjacency matrix from adjacencyList. If value == INF, no path exists between start and end index.
-    std::vector<std::vector<int>> distance(departureGraphList->size(), std::vector<int>(departureGraphList->size(), INF));
-    // Sequence table to store shortest paths for future operations.
-    std::vector<std::vector<int>> *shortestRouteTable;
+    bestValue.assign(connectionList->size(), INF);
+    nextConnection.assign(connectionList->size(), -1);
 
-    if (includeLayovers)
-    {
-        shortestRouteWithLayoverSequenceTable = new std::vector<std::vector<int>>(departureGraphList->size(), std::vector<int>(departureGraphList->size(), INF));
-        shortestRouteTable = shortestRouteWithLayoverSequenceTable;
-    }
-    else
-    {
-        shortestRouteWithoutLayoverSequenceTable = new std::vector<std::vector<int>>(departureGraphList->size(), std::vector<int>(departureGraphList->size(), INF));
-        shortestRouteTable = shortestRouteWithoutLayoverSequenceTable;
-    }
+    // Per station list of (departure time, connection index), ordered by decreasing departure time with strictly improving values.
+    // A connection leaving earlier that does no better than one already listed can never be the best choice, so it is not stored.
+    std::vector<std::vector<std::pair<int, int>>> stationProfiles(stationCount + 1);
 
-    for (int i = 0; i < departureGraphList->size(); i++)
+    for (int i = (int)connectionList->size() - 1; i >= 0; i--)
     {
-        Departure currentDeparture = (*departureGraphList)[i];
-    
-        for (int j = 0; j < currentDeparture.GetTripCount(); j++)
+        const Connection& current = (*connectionList)[i];
+        int rideTime = current.arrivalTime - current.departureTime;
+
+        if (current.arrivalStationID == destinationID)
         {
-            int startID = currentDeparture.GetLookUpKey();
-            // if not include layovers, only include ride time in weight calculation.
-            int tripWeight = includeLayovers? currentDeparture.GetTrip(j).tripWeight : currentDeparture.GetTrip(j).rideTimeToDestinationMins;            
-            int destinationID = currentDeparture.GetTrip(j).destinationKey;
+            bestValue[i] = includeLayovers ? current.arrivalTime : rideTime;
+        }
+        else if (current.arrivalStationID > 0 && current.arrivalStationID <= stationCount)
+        {
+            // Connections leaving after this train arrives are a prefix of the profile, the last one of them is the best.
+            const std::vector<std::pair<int, int>>& profile = stationProfiles[current.arrivalStationID];
+            auto firstMissed = std::partition_point(profile.begin(), profile.end(),
+                [&current](const std::pair<int, int>& entry) { return entry.first > current.arrivalTime; });
 
-            distance[startID][destinationID] = tripWeight;
-            (*shortestRouteTable)[startID][destinationID] = destinationID;
+            if (firstMissed != profile.begin())
+            {
+                int connectionIndex = (firstMissed - 1)->second;
+                bestValue[i] = includeLayovers ? bestValue[connectionIndex] : bestValue[connectionIndex] + rideTime;
+                nextConnection[i] = connectionIndex;
+            }
         }
-    }
 
-    //Floyd Warshal Algorithm
-    for (int k = 0; k < departureGraphList->size(); k++)
-    {
-        for (int i = 0; i < departureGraphList->size(); i++)
+        if (bestValue[i] != INF && current.departureStationID > 0 && current.departureStationID <= stationCount)
         {
-            for (int j = 0; j < departureGraphList->size(); j++)
+            std::vector<std::pair<int, int>>& profile = stationProfiles[current.departureStationID];
+            if (profile.empty() || bestValue[i] < bestValue[profile.back().second])
             {
-                if (distance[i][k] != INF && distance[k][j] != INF &&
-                    distance[i][k] + distance[k][j] < distance[i][j])
-                {
-                    distance[i][j] = distance[i][k] + distance[k][j];                    
-                    // Update shortest path table to reflect new shorter node.
-                    (*shortestRouteTable)[i][j] = (*shortestRouteTable)[i][k];
-                }
+                profile.push_back({current.departureTime, i});
             }
         }
     }
 }
 
-Route StationGraph::GetShortestRoute(int departureStationID, int destinationStationID, bool includeLayovers)
+// A negative twentyFourTime allows any departure and picks the lowest weight. Otherwise trains leaving at or after twentyFourTime
+// are considered and the earliest arrival wins, matching get_shortest_route_from_time.
+Route StationGraph::get_shortest_route_by_scan(int departureID, int destinationID, bool includeLayovers, int twentyFourTime)
 {
-    if (includeLayovers)
+    std::vector<int> bestValue;
+    std::vector<int> nextConnection;
+    connection_scan(destinationID, includeLayovers, bestValue, nextConnection);
+
+    int earliestDeparture = twentyFourTime >= 0 ? twentyFourTime : -1;
+    std::tuple<int, int, int> minimumCost = {Utility::INF, Utility::INF, Utility::INF};
+    int firstConnection = -1;
+    for (int i = 0; i < connectionList->size(); i++)
     {
-        return get_shortest_route(departureStationID, destinationStationID, *shortestRouteWithLayoverSequenceTable, true);
+        const Connection& current = (*connectionList)[i];
+        if (current.departureStationID != departureID || bestValue[i] == Utility::INF || current.departureTime < earliestDeparture)
+        {
+            continue;
+        }
+
+        // Compared by arrival first for "leave at or after" queries, then weight, ties go to the lowest lookUpKey like the table walk
+        // in get_shortest_route.
+        int weight = includeLayovers ? bestValue[i] - current.departureTime : bestValue[i];
+        std::tuple<int, int, int> cost = {twentyFourTime >= 0 ? bestValue[i] : weight, weight, current.lookUpKey};
+        if (cost < minimumCost)
+        {
+            minimumCost = cost;
+            firstConnection = i;
+        }
     }
-    else
+
+    if (firstConnection == -1)
     {
-        return get_shortest_route(departureStationID, destinationStationID, *shortestRouteWithoutLayoverSequenceTable, false);
+        return {-1, {}};
     }
+
+    std::vector<Connection> legs;
+    for (int i = firstConnection; i != -1; i = nextConnection[i])
+    {
+        legs.push_back((*connectionList)[i]);
+    }
+
+    return build_route(legs, destinationID);
 }
 
-Route StationGraph::GetRouteFromTime(int twentyFourTime, int departureStationID, int destinationStationID)
-{    
-    return get_shortest_route_from_time(departureStationID, destinationStationID, twentyFourTime);
+// Converts a chain of trains into a Route over the departure graph, the last leg ends at the terminating vertex of destinationID.
+Route StationGraph::build_route(const std::vector<Connection>& legs, int destinationID)
+{
+    int terminalKey = get_terminal_key(destinationID);
+    std::vector<TripPlusLayover> shortPath;
+
+    for (int i = 0; i < legs.size(); i++)
+    {
+        int rideTime = legs[i].arrivalTime - legs[i].departureTime;
+
+        if (i + 1 == legs.size())
+        {
+            shortPath.push_back({terminalKey, rideTime, 0, rideTime});
+        }
+        else
+        {
+            int layover = legs[i + 1].departureTime - legs[i].arrivalTime;
+            shortPath.push_back({legs[i + 1].lookUpKey, rideTime, layover, rideTime + layover});
+        }
+    }
+
+    return {legs[0].lookUpKey, shortPath};
 }
 
-int StationGraph::GetVertexCount()
+void StationGraph::build_route_patterns(const std::vector<Connection>& tripDataTable)
 {
-    return stationCount;
+    // Same grouping as stationsGraphList, one list per departure station, split further by destination station.
+    routePatternList = new std::vector<std::vector<RoutePattern>>(stationCount);
+
+    for (int i = 0; i < tripDataTable.size(); i++)
+    {
+        add_to_route_patterns(tripDataTable[i]);
+    }
+
+    for (std::vector<RoutePattern>& stationPatterns : *routePatternList)
+    {
+        for (RoutePattern& pattern : stationPatterns)
+        {
+            pattern.SortTrips();
+        }
+    }
 }
 
-Station StationGraph::GetStationFromGraph(int stationID)
+// Patterns are listed in the order their first trip is added, trips still need SortTrips once all are in.
+void StationGraph::add_to_route_patterns(const Connection& trip)
 {
-    int iDAsZeroIndex = stationID - 1;
-    if (iDAsZeroIndex < stationsGraphList->size() && iDAsZeroIndex >= 0)
+    if (trip.departureStationID < 1 || trip.departureStationID > stationCount)
     {
-        return (*stationsGraphList)[iDAsZeroIndex];
+        return;
     }
-    else
+
+    std::vector<RoutePattern>& stationPatterns = (*routePatternList)[trip.departureStationID - 1];
+    auto pattern = std::find_if(stationPatterns.begin(), stationPatterns.end(),
+        [&trip](const RoutePattern& p) { return p.GetDestinationStationID() == trip.arrivalStationID; });
+
+    if (pattern == stationPatterns.end())
     {
-        // return invalid station if bad station ID
-        return Station({-1, {}});
+        stationPatterns.push_back({trip.departureStationID, trip.arrivalStationID});
+        pattern = stationPatterns.end() - 1;
     }
+    pattern->AddTrip(trip);
 }
 
-Departure StationGraph::GetDepartureFromGraph(int lookUpKey)
+// One RAPTOR run for a passenger boarding a train at departureID that leaves exactly at twentyFourTime. Round k only boards trains from
+// stations improved in round k - 1, so its labels are the earliest arrivals using k trains. journeyByRound[k] holds the trains of the
+// itinerary reaching destinationID in round k, or is empty if round k did not improve on fewer trains.
+void StationGraph::raptor_rounds(int departureID, int destinationID, int twentyFourTime, int maxRounds, std::vector<std::vector<Connection>>& journeyByRound)
 {
-    return (*departureGraphList)[lookUpKey];
+    const int INF = Utility::INF;
+    std::vector<std::vector<int>> arrival(maxRounds + 1, std::vector<int>(stationCount + 1, INF));
+    std::vector<std::vector<Connection>> boardedTrip(maxRounds + 1, std::vector<Connection>(stationCount + 1));
+    std::vector<int> bestArrival(stationCount + 1, INF);
+    std::vector<int> markedStations = {departureID};
+
+    arrival[0][departureID] = twentyFourTime;
+    journeyByRound.assign(maxRounds + 1, {});
+
+    for (int round = 1; round <= maxRounds && !markedStations.empty(); round++)
+    {
+        std::vector<int> improvedStations;
+
+        for (int stationID : markedStations)
+        {
+            for (const RoutePattern& pattern : (*routePatternList)[stationID - 1])
+            {
+                // The first train must leave at the requested time, later ones only need to leave after the passenger arrives.
+                int tripIndex = pattern.FindEarliestArrival(arrival[round - 1][stationID], round == 1);
+                int targetID = pattern.GetDestinationStationID();
+                if (tripIndex == -1 || targetID < 1 || targetID > stationCount)
+                {
+                    continue;
+                }
+
+                // Local and target pruning, an arrival is only kept if it beats everything found so far at that station and at the destination.
+                Connection trip = pattern.GetTrip(tripIndex);
+                if (trip.arrivalTime < bestArrival[targetID] && trip.arrivalTime < bestArrival[destinationID])
+                {
+                    if (arrival[round][targetID] == INF)
+                    {
+                        improvedStations.push_back(targetID);
+                    }
+                    arrival[round][targetID] = trip.arrivalTime;
+                    boardedTrip[round][targetID] = trip;
+                    bestArrival[targetID] = trip.arrivalTime;
+                }
+            }
+        }
+
+        if (arrival[round][destinationID] != INF)
+        {
+            // Walk back one round per train to recover the itinerary.
+            int stationID = destinationID;
+            for (int k = round; k >= 1; k--)
+            {
+                journeyByRound[round].push_back(boardedTrip[k][stationID]);
+                stationID = boardedTrip[k][stationID].departureStationID;
+            }
+            std::reverse(journeyByRound[round].begin(), journeyByRound[round].end());
+        }
+
+        markedStations = improvedStations;
+    }
 }
 
-// Duplication of code between two graph types. Might want to pull this out to be more
-// generic.
-Station StationGraph::GetStationFromArrivalGraph(int stationID)
+void StationGraph::build_station_departures(const std::vector<Connection>& tripDataTable)
 {
-    int iDAsZeroIndex = stationID - 1;
-    if (iDAsZeroIndex < stationArrivalsGraphList->size() && iDAsZeroIndex >= 0)
+    stationDepartureList = new std::vector<std::vector<Connection>>(stationCount);
+
+    for (int i = 0; i < tripDataTable.size(); i++)
     {
-        return (*stationArrivalsGraphList)[iDAsZeroIndex];
+        const Connection& trip = tripDataTable[i];
+        if (trip.departureStationID >= 1 && trip.departureStationID <= stationCount)
+        {
+            (*stationDepartureList)[trip.departureStationID - 1].push_back(trip);
+        }
     }
-    else
+
+    for (std::vector<Connection>& departures : *stationDepartureList)
     {
-        // return invalid station if bad station ID
-        return Station({-1, {}});
+        std::stable_sort(departures.begin(), departures.end(),
+            [](const Connection& a, const Connection& b) { return a.departureTime < b.departureTime; });
     }
 }
 
-bool StationGraph::PathExists(int startStationID, int targetStationID)
+// Dijkstra over trains rather than stations, the cost of a train is the arrival time at the end of it when layovers are included,
+// or the riding time so far when they are not. Starts from every train leaving departureID at or after twentyFourTime. With layovers
+// included and several start times the cheapest itinerary is the earliest arriving one.
+// Returns the trains of the cheapest itinerary, empty if the destination can't be reached.
+std::vector<Connection> StationGraph::time_dependent_dijkstra(int departureID, int destinationID, bool includeLayovers, int twentyFourTime)
 {
-    return (get_shortest_route(startStationID, targetStationID, *shortestRouteWithLayoverSequenceTable, true).RouteIsValid());
-}
+    const int INF = Utility::INF;
+    int tripCount = tripList->size();
 
-bool StationGraph::DirectPathExists(int startStationID, int targetStationID)
-{
-    return direct_route_exists(startStationID, targetStationID, *shortestRouteWithLayoverSequenceTable);    
+    // Trains are addressed by (station index, position in that station's sorted departures), cost and parent are indexed by lookUpKey.
+    typedef std::pair<int, int> TrainLocation;
+    std::vector<int> cost(tripCount, INF);
+    std::vector<TrainLocation> parent(tripCount, {-1, -1});
+    // Trains are popped in cost order, so the first one to reach a station has already been used to board everything
+    // leaving after it arrives. Later ones only need to look at departures between their arrival and that earlier arrival.
+    std::vector<int> relaxedAfter(stationCount, INF);
+    std::priority_queue<std::pair<int, TrainLocation>, std::vector<std::pair<int, TrainLocation>>, std::greater<std::pair<int, TrainLocation>>> queue;
+
+    const std::vector<Connection>& firstDepartures = (*stationDepartureList)[departureID - 1];
+    for (int i = 0; i < firstDepartures.size(); i++)
+    {
+        const Connection& trip = firstDepartures[i];
+        if (trip.departureTime >= twentyFourTime)
+        {
+            cost[trip.lookUpKey] = includeLayovers ? trip.arrivalTime : trip.arrivalTime - trip.departureTime;
+            queue.push({cost[trip.lookUpKey], {departureID - 1, i}});
+        }
+    }
+
+    while (!queue.empty())
+    {
+        int currentCost = queue.top().first;
+        TrainLocation location = queue.top().second;
+        queue.pop();
+
+        const Connection& current = (*stationDepartureList)[location.first][location.second];
+        if (currentCost > cost[current.lookUpKey])
+        {
+            continue;
+        }
+
+        if (current.arrivalStationID == destinationID)
+        {
+            std::vector<Connection> legs;
+            for (TrainLocation step = location; step.first != -1; step = parent[(*stationDepartureList)[step.first][step.second].lookUpKey])
+            {
+                legs.push_back((*stationDepartureList)[step.first][step.second]);
+            }
+            std::reverse(legs.begin(), legs.end());
+            return legs;
+        }
+
+        int stationIndex = current.arrivalStationID - 1;
+        if (stationIndex < 0 || stationIndex >= stationCount || current.arrivalTime >= relaxedAfter[stationIndex])
+        {
+            continue;
+        }
+
+        const std::vector<Connection>& departures = (*stationDepartureList)[stationIndex];
+        int previousArrival = relaxedAfter[stationIndex];
+        int first = std::partition_point(departures.begin(), departures.end(),
+            [&current](const Connection& trip) { return trip.departureTime <= current.arrivalTime; }) - departures.begin();
+        int last = std::partition_point(departures.begin(), departures.end(),
+            [previousArrival](const Connection& trip) { return trip.departureTime <= previousArrival; }) - departures.begin();
+        relaxedAfter[stationIndex] = current.arrivalTime;
+
+        for (int i = first; i < last; i++)
+        {
+            const Connection& next = departures[i];
+            int nextCost = includeLayovers ? next.arrivalTime : currentCost + next.arrivalTime - next.departureTime;
+            if (nextCost < cost[next.lookUpKey])
+            {
+                cost[next.lookUpKey] = nextCost;
+                parent[next.lookUpKey] = location;
+                queue.push({nextCost, {stationIndex, i}});
+            }
+        }
+    }
+
+    return {};
+}
+
+// Dijkstra over trains for the least overall travel time from departureID, leaving at any time. Every train is labelled with the
+// latest departure from departureID it can be reached from and costs its arrival minus that departure, the weight with layovers,
+// so one run covers every start time. Equal weights go to the earlier start, like trying the start times in order.
+std::vector<Connection> StationGraph::least_duration_dijkstra(int departureID, int destinationID)
+{
+    int tripCount = tripList->size();
+
+    typedef std::pair<int, int> TrainLocation;
+    std::vector<int> latestStart(tripCount, -1);
+    std::vector<TrainLocation> parent(tripCount, {-1, -1});
+    // Trains already popped at each station as start -> arrival, only kept while a later start also arrives later. Departures
+    // after the arrival of an entry starting at least as late have been boarded with a label as good as any later train's.
+    std::vector<std::map<int, int>> boardedAfter(stationCount);
+    typedef std::tuple<int, int, TrainLocation> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    const std::vector<Connection>& firstDepartures = (*stationDepartureList)[departureID - 1];
+    for (int i = 0; i < firstDepartures.size(); i++)
+    {
+        const Connection& trip = firstDepartures[i];
+        latestStart[trip.lookUpKey] = trip.departureTime;
+        queue.push({trip.arrivalTime - trip.departureTime, trip.departureTime, {departureID - 1, i}});
+    }
+
+    while (!queue.empty())
+    {
+        int start = std::get<1>(queue.top());
+        TrainLocation location = std::get<2>(queue.top());
+        queue.pop();
+
+        const Connection& current = (*stationDepartureList)[location.first][location.second];
+        if (start != latestStart[current.lookUpKey])
+        {
+            continue;
+        }
+
+        if (current.arrivalStationID == destinationID)
+        {
+            std::vector<Connection> legs;
+            for (TrainLocation step = location; step.first != -1; step = parent[(*stationDepartureList)[step.first][step.second].lookUpKey])
+            {
+                legs.push_back((*stationDepartureList)[step.first][step.second]);
+            }
+            std::reverse(legs.begin(), legs.end());
+            return legs;
+        }
+
+        int stationIndex = current.arrivalStationID - 1;
+        if (stationIndex < 0 || stationIndex >= stationCount)
+        {
+            continue;
+        }
+
+        // The earliest arrival of an entry starting at least as late bounds the departures left to board.
+        std::map<int, int>& boarded = boardedAfter[stationIndex];
+        auto laterStart = boarded.lower_bound(start);
+        int boardedUntil = laterStart == boarded.end() ? Utility::INF : laterStart->second;
+        if (current.arrivalTime >= boardedUntil)
+        {
+            continue;
+        }
+
+        auto entry = boarded.upper_bound(start);
+        while (entry != boarded.begin() && std::prev(entry)->second >= current.arrivalTime)
+        {
+            entry = boarded.erase(std::prev(entry));
+        }
+        boarded.emplace_hint(entry, start, current.arrivalTime);
+
+        const std::vector<Connection>& departures = (*stationDepartureList)[stationIndex];
+        int first = std::partition_point(departures.begin(), departures.end(),
+            [&current](const Connection& trip) { return trip.departureTime <= current.arrivalTime; }) - departures.begin();
+        int last = std::partition_point(departures.begin(), departures.end(),
+            [boardedUntil](const Connection& trip) { return trip.departureTime <= boardedUntil; }) - departures.begin();
+
+        for (int i = first; i < last; i++)
+        {
+            const Connection& next = departures[i];
+            if (start > latestStart[next.lookUpKey])
+            {
+                latestStart[next.lookUpKey] = start;
+                parent[next.lookUpKey] = location;
+                queue.push({next.arrivalTime - start, start, {stationIndex, i}});
+            }
+        }
+    }
+
+    return {};
+}
+
+// A negative twentyFourTime allows any departure and picks the lowest weight, otherwise the earliest arrival leaving at or after
+// twentyFourTime wins, matching get_shortest_route_from_time.
+Route StationGraph::get_shortest_route_by_dijkstra(int departureID, int destinationID, bool includeLayovers, int twentyFourTime)
+{
+    if (departureID < 1 || departureID > stationCount)
+    {
+        return {-1, {}};
+    }
+
+    std::vector<Connection> bestLegs;
+    if (!includeLayovers)
+    {
+        bestLegs = time_dependent_dijkstra(departureID, destinationID, false, -1);
+    }
+    else if (twentyFourTime >= 0)
+    {
+        // Arrival time is the cost with layovers, so one run from every later departure finds the earliest arrival. Runs from
+        // departures after the one found only look for an equal arrival that leaves later.
+        std::vector<Connection> legs = time_dependent_dijkstra(departureID, destinationID, true, twentyFourTime);
+        while (!legs.empty() && (bestLegs.empty() || legs.back().arrivalTime == bestLegs.back().arrivalTime))
+        {
+            bestLegs = legs;
+            legs = time_dependent_dijkstra(departureID, destinationID, true, bestLegs.front().departureTime + 1);
+        }
+    }
+    else
+    {
+        bestLegs = least_duration_dijkstra(departureID, destinationID);
+    }
+
+    if (bestLegs.empty())
+    {
+        return {-1, {}};
+    }
+
+    return build_route(bestLegs, destinationID);
+}
+
+// Dijkstra over the departure graph with the same edge weights as floyd_warshal_shortest_paths. When twentyFourTime is negative every
+// departure leaving departureID starts at distance 0. Otherwise the departures leaving at or after twentyFourTime start at their
+// departure time, so with layovers included the distances are arrival times and the tree leads to the earliest arrival.
+std::shared_ptr<const ShortestPathTree> StationGraph::build_shortest_path_tree(int departureID, bool includeLayovers, int twentyFourTime)
+{
+    const int INF = Utility::INF;
+    const int vertexCount = departureGraphList->GetVertexCount();
+    std::shared_ptr<ShortestPathTree> tree = std::make_shared<ShortestPathTree>();
+    tree->distance.assign(vertexCount, INF);
+    tree->parent.assign(vertexCount, -1);
+    // Departure time each path starts from, among equal arrivals the path leaving latest wins. Stays 0 when all start at distance 0.
+    std::vector<int> startTime(vertexCount, 0);
+    // Ordered by distance, then by latest start.
+    std::priority_queue<std::tuple<int, int, int>, std::vector<std::tuple<int, int, int>>, std::greater<std::tuple<int, int, int>>> queue;
+
+    int earliestDeparture = twentyFourTime >= 0 ? twentyFourTime : -1;
+    for (int departureKey : (*departureKeysByStation)[departureID - 1])
+    {
+        int departureTime = departureGraphList->GetDepartureTime(departureKey);
+        if (departureTime >= earliestDeparture)
+        {
+            tree->distance[departureKey] = twentyFourTime >= 0 ? departureTime : 0;
+            startTime[departureKey] = twentyFourTime >= 0 ? departureTime : 0;
+            queue.push({tree->distance[departureKey], -startTime[departureKey], departureKey});
+        }
+    }
+
+    while (!queue.empty())
+    {
+        int currentDistance = std::get<0>(queue.top());
+        int currentStart = -std::get<1>(queue.top());
+        int currentKey = std::get<2>(queue.top());
+        queue.pop();
+        if (currentDistance > tree->distance[currentKey] || currentStart < startTime[currentKey])
+        {
+            continue;
+        }
+
+        for (size_t edge = departureGraphList->GetEdgeBegin(currentKey); edge < departureGraphList->GetEdgeEnd(currentKey); edge++)
+        {
+            int destinationKey = departureGraphList->GetDestinationKey(edge);
+            int nextDistance = currentDistance + (includeLayovers ? departureGraphList->GetWeight(edge) : departureGraphList->GetRideMinutes(edge));
+            if (nextDistance < tree->distance[destinationKey] ||
+                (nextDistance == tree->distance[destinationKey] && currentStart > startTime[destinationKey]))
+            {
+                tree->distance[destinationKey] = nextDistance;
+                tree->parent[destinationKey] = currentKey;
+                startTime[destinationKey] = currentStart;
+                queue.push({nextDistance, -currentStart, destinationKey});
+            }
+        }
+    }
+
+    return tree;
+}
+
+std::shared_ptr<const ShortestPathTree> StationGraph::get_shortest_path_tree(int departureID, bool includeLayovers, int twentyFourTime)
+{
+    long long key = ShortestPathTreeCache::MakeKey(departureID, includeLayovers, twentyFourTime);
+    std::shared_ptr<const ShortestPathTree> tree = shortestPathTreeCache->Find(key);
+    if (tree)
+    {
+        return tree;
+    }
+
+    // Built without holding the cache lock, if two queries miss on the same station at once the first insert wins.
+    return shortestPathTreeCache->Insert(key, build_shortest_path_tree(departureID, includeLayovers, twentyFourTime));
+}
+
+// Walks the parents back from the destination's terminal vertex, the shortest route ends there like the table walk in get_route.
+Route StationGraph::get_shortest_route_by_tree(int departureID, int destinationID, bool includeLayovers, int twentyFourTime)
+{
+    if (departureID < 1 || departureID > stationCount || destinationID < 1 || destinationID > stationCount)
+    {
+        return {-1, {}};
+    }
+
+    std::shared_ptr<const ShortestPathTree> tree = get_shortest_path_tree(departureID, includeLayovers, twentyFourTime);
+    int currentKey = get_terminal_key(destinationID);
+    if (tree->distance[currentKey] == Utility::INF)
+    {
+        return {-1, {}};
+    }
+
+    std::vector<TripPlusLayover> shortPath;
+    while (tree->parent[currentKey] != -1)
+    {
+        shortPath.push_back(departureGraphList->FindEdge(tree->parent[currentKey], currentKey));
+        currentKey = tree->parent[currentKey];
+    }
+    std::reverse(shortPath.begin(), shortPath.end());
+
+    Route finalRoute{currentKey, shortPath};
+    if (!finalRoute.RouteIsValid())
+    {
+        return {-1, {}};
+    }
+    return finalRoute;
+}
+
+// Runs connection_scan once per destination in each mode, see add_transfer_patterns.
+void StationGraph::build_transfer_patterns()
+{
+    transferPatternTable = new TransferPatternTable(stationCount);
+    std::vector<char> departureStations(stationCount + 1, 1);
+    std::vector<int> bestValue;
+    std::vector<int> nextConnection;
+    for (int destinationID = 1; destinationID <= stationCount; destinationID++)
+    {
+        add_transfer_patterns(destinationID, departureStations, bestValue, nextConnection);
+    }
+
+    transferPatternTable->Freeze();
+}
+
+// Adds the patterns towards destinationID from the marked departure stations. With layovers included, walking back from the latest
+// departure and keeping the trains that arrive earlier than everything leaving later from the same station gives every journey
+// that is best on both departure and arrival time, which holds the shortest overall journey and every earliest arrival for a
+// "leave at or after" query. With ride time only, the least riding time from each station is the one journey needed.
+void StationGraph::add_transfer_patterns(int destinationID, const std::vector<char>& departureStations, std::vector<int>& bestValue,
+    std::vector<int>& nextConnection)
+{
+    const int INF = Utility::INF;
+    std::vector<int> patternStations;
+    auto add_journey = [&](int firstConnection)
+    {
+        patternStations.assign(1, (*connectionList)[firstConnection].departureStationID);
+        for (int i = firstConnection; i != -1; i = nextConnection[i])
+        {
+            patternStations.push_back((*connectionList)[i].arrivalStationID);
+        }
+        transferPatternTable->AddPattern(patternStations);
+    };
+
+    connection_scan(destinationID, true, bestValue, nextConnection);
+    std::vector<int> earliestArrival(stationCount + 1, INF);
+    for (int i = (int)connectionList->size() - 1; i >= 0; i--)
+    {
+        int departureID = (*connectionList)[i].departureStationID;
+        if (departureID >= 1 && departureID <= stationCount && departureStations[departureID] && bestValue[i] < earliestArrival[departureID])
+        {
+            earliestArrival[departureID] = bestValue[i];
+            add_journey(i);
+        }
+    }
+
+    connection_scan(destinationID, false, bestValue, nextConnection);
+    std::vector<int> leastRideConnection(stationCount + 1, -1);
+    for (int i = 0; i < connectionList->size(); i++)
+    {
+        int departureID = (*connectionList)[i].departureStationID;
+        if (departureID >= 1 && departureID <= stationCount && departureStations[departureID] && bestValue[i] != INF &&
+            (leastRideConnection[departureID] == -1 || bestValue[i] < bestValue[leastRideConnection[departureID]]))
+        {
+            leastRideConnection[departureID] = i;
+        }
+    }
+    for (int departureID = 1; departureID <= stationCount; departureID++)
+    {
+        if (leastRideConnection[departureID] != -1)
+        {
+            add_journey(leastRideConnection[departureID]);
+        }
+    }
+}
+
+// The stations reachable from a connection are its arrival station plus everything reachable from the connections leaving there
+// after it arrives. One walk from the latest connection to the earliest fills them in, a word of 64 stations at a time, keeping for
+// each station a profile of its departures by decreasing time where every entry's row holds the stations reachable from it or any
+// later departure, so the connections a train can change to are always one row.
+void StationGraph::build_reachability_index()
+{
+    reachableStations = new ReachabilityIndex(stationCount);
+    nonstopStations = new ReachabilityIndex(stationCount);
+    const int rowWords = reachableStations->GetRowWords();
+
+    std::vector<uint64_t> laterReach(connectionList->size() * rowWords, 0);
+    std::vector<std::vector<int>> stationProfiles(stationCount + 1);
+    for (int i = (int)connectionList->size() - 1; i >= 0; i--)
+    {
+        const Connection& current = (*connectionList)[i];
+        if (current.departureStationID < 1 || current.departureStationID > stationCount ||
+            current.arrivalStationID < 1 || current.arrivalStationID > stationCount)
+        {
+            continue;
+        }
+
+        uint64_t* row = laterReach.data() + (size_t)i * rowWords;
+        int bit = current.arrivalStationID - 1;
+        row[bit / 64] |= (uint64_t)1 << (bit % 64);
+
+        // Connections leaving after this train arrives are a prefix of the profile, the last one of them covers them all.
+        const std::vector<int>& profile = stationProfiles[current.arrivalStationID];
+        auto firstMissed = std::partition_point(profile.begin(), profile.end(),
+            [&](int connectionIndex) { return (*connectionList)[connectionIndex].departureTime > current.arrivalTime; });
+        if (firstMissed != profile.begin())
+        {
+            const uint64_t* connectingRow = laterReach.data() + (size_t)*(firstMissed - 1) * rowWords;
+            for (int w = 0; w < rowWords; w++)
+            {
+                row[w] |= connectingRow[w];
+            }
+        }
+
+        std::vector<int>& departureProfile = stationProfiles[current.departureStationID];
+        if (!departureProfile.empty())
+        {
+            const uint64_t* laterRow = laterReach.data() + (size_t)departureProfile.back() * rowWords;
+            for (int w = 0; w < rowWords; w++)
+            {
+                row[w] |= laterRow[w];
+            }
+        }
+        departureProfile.push_back(i);
+    }
+
+    for (int stationID = 1; stationID <= stationCount; stationID++)
+    {
+        // The earliest departure's row covers every train leaving the station.
+        if (!stationProfiles[stationID].empty())
+        {
+            reachableStations->AddRow(stationID, laterReach.data() + (size_t)stationProfiles[stationID].back() * rowWords);
+        }
+        for (const Connection& trip : (*stationDepartureList)[stationID - 1])
+        {
+            if (trip.arrivalStationID >= 1 && trip.arrivalStationID <= stationCount)
+            {
+                nonstopStations->Add(stationID, trip.arrivalStationID);
+            }
+        }
+    }
+}
+
+const RoutePattern* StationGraph::find_route_pattern(int departureID, int destinationID)
+{
+    for (const RoutePattern& pattern : (*routePatternList)[departureID - 1])
+    {
+        if (pattern.GetDestinationStationID() == destinationID)
+        {
+            return &pattern;
+        }
+    }
+    return nullptr;
+}
+
+// Boards firstTrip, then at each following station of the pattern the earliest arriving train to the next one that leaves after
+// the passenger arrives. Arriving earlier never loses a train, so this is the earliest arrival the pattern allows after firstTrip.
+// Returns the trains taken, empty if the pattern can't be completed.
+std::vector<Connection> StationGraph::follow_transfer_pattern(const int* patternStations, int stationsInPattern, const Connection& firstTrip)
+{
+    std::vector<Connection> legs = {firstTrip};
+    for (int k = 2; k < stationsInPattern; k++)
+    {
+        const RoutePattern* pattern = find_route_pattern(patternStations[k - 1], patternStations[k]);
+        int tripIndex = pattern ? pattern->FindEarliestArrival(legs.back().arrivalTime, false) : -1;
+        if (tripIndex == -1)
+        {
+            return {};
+        }
+        legs.push_back(pattern->GetTrip(tripIndex));
+    }
+    return legs;
+}
+
+// Least riding time over the trains of the pattern, one leg at a time. A train's cost is its ride plus the cheapest train of the
+// previous leg arriving before it leaves. Ties go to the earliest listed trains. Returns the trains taken, empty if none connect.
+std::vector<Connection> StationGraph::least_ride_time_on_pattern(const int* patternStations, int stationsInPattern)
+{
+    const int INF = Utility::INF;
+    // Per leg, the trains with their cost and the index of the train taken on the previous leg.
+    std::vector<std::vector<std::tuple<Connection, int, int>>> legTrains(stationsInPattern - 1);
+    for (int k = 0; k + 1 < stationsInPattern; k++)
+    {
+        const RoutePattern* pattern = find_route_pattern(patternStations[k], patternStations[k + 1]);
+        if (!pattern)
+        {
+            return {};
+        }
+
+        // Previous leg trains ordered by arrival with a running minimum, so the cheapest one arriving before a departure is a lookup.
+        std::vector<std::pair<int, int>> cheapestArrivingBy;
+        if (k > 0)
+        {
+            std::vector<int> byArrival;
+            for (int i = 0; i < legTrains[k - 1].size(); i++)
+            {
+                if (std::get<1>(legTrains[k - 1][i]) != INF)
+                {
+                    byArrival.push_back(i);
+                }
+            }
+            std::stable_sort(byArrival.begin(), byArrival.end(), [&legTrains, k](int a, int b)
+                { return std::get<0>(legTrains[k - 1][a]).arrivalTime < std::get<0>(legTrains[k - 1][b]).arrivalTime; });
+            for (int i : byArrival)
+            {
+                if (cheapestArrivingBy.empty() || std::get<1>(legTrains[k - 1][i]) < std::get<1>(legTrains[k - 1][cheapestArrivingBy.back().second]))
+                {
+                    cheapestArrivingBy.push_back({std::get<0>(legTrains[k - 1][i]).arrivalTime, i});
+                }
+                else
+                {
+                    cheapestArrivingBy.push_back({std::get<0>(legTrains[k - 1][i]).arrivalTime, cheapestArrivingBy.back().second});
+                }
+            }
+        }
+
+        for (int j = 0; j < pattern->GetTripCount(); j++)
+        {
+            Connection trip = pattern->GetTrip(j);
+            int rideTime = trip.arrivalTime - trip.departureTime;
+            if (k == 0)
+            {
+                legTrains[k].push_back({trip, rideTime, -1});
+                continue;
+            }
+
+            auto firstMissed = std::partition_point(cheapestArrivingBy.begin(), cheapestArrivingBy.end(),
+                [&trip](const std::pair<int, int>& entry) { return entry.first < trip.departureTime; });
+            if (firstMissed == cheapestArrivingBy.begin())
+            {
+                legTrains[k].push_back({trip, INF, -1});
+            }
+            else
+            {
+                int previous = (firstMissed - 1)->second;
+                legTrains[k].push_back({trip, std::get<1>(legTrains[k - 1][previous]) + rideTime, previous});
+            }
+        }
+    }
+
+    int cheapest = -1;
+    for (int j = 0; j < legTrains.back().size(); j++)
+    {
+        if (std::get<1>(legTrains.back()[j]) != INF && (cheapest == -1 || std::get<1>(legTrains.back()[j]) < std::get<1>(legTrains.back()[cheapest])))
+        {
+            cheapest = j;
+        }
+    }
+
+    std::vector<Connection> legs;
+    for (int k = (int)legTrains.size() - 1; k >= 0 && cheapest != -1; k--)
+    {
+        legs.push_back(std::get<0>(legTrains[k][cheapest]));
+        cheapest = std::get<2>(legTrains[k][cheapest]);
+    }
+    std::reverse(legs.begin(), legs.end());
+    return legs;
+}
+
+// Tries every pattern of the pair. A negative twentyFourTime picks the lowest weight over every first train, otherwise the earliest
+// arrival among first trains leaving at or after twentyFourTime wins, equal arrivals going to the later
+// departure like get_shortest_route_from_time. Equal weights go to the lowest lookUpKey of the first train.
+Route StationGraph::get_shortest_route_by_patterns(int departureID, int destinationID, bool includeLayovers, int twentyFourTime)
+{
+    if (departureID < 1 || departureID > stationCount || destinationID < 1 || destinationID > stationCount)
+    {
+        return {-1, {}};
+    }
+
+    int earliestDeparture = twentyFourTime >= 0 ? twentyFourTime : -1;
+    std::tuple<int, int, int> minimumCost = {Utility::INF, Utility::INF, Utility::INF};
+    std::vector<Connection> bestLegs;
+    for (int p = 0; p < transferPatternTable->GetPatternCount(departureID, destinationID); p++)
+    {
+        int stationsInPattern = 0;
+        const int* patternStations = transferPatternTable->GetPattern(departureID, destinationID, p, stationsInPattern);
+
+        if (!includeLayovers)
+        {
+            std::vector<Connection> legs = least_ride_time_on_pattern(patternStations, stationsInPattern);
+            int rideTime = 0;
+            for (const Connection& leg : legs)
+            {
+                rideTime += leg.arrivalTime - leg.departureTime;
+            }
+            std::tuple<int, int, int> cost = {rideTime, 0, legs.empty() ? 0 : legs.front().lookUpKey};
+            if (!legs.empty() && cost < minimumCost)
+            {
+                minimumCost = cost;
+                bestLegs = legs;
+            }
+            continue;
+        }
+
+        const RoutePattern* firstPattern = find_route_pattern(patternStations[0], patternStations[1]);
+        for (int j = 0; firstPattern && j < firstPattern->GetTripCount(); j++)
+        {
+            Connection firstTrip = firstPattern->GetTrip(j);
+            if (firstTrip.departureTime < earliestDeparture)
+            {
+                continue;
+            }
+
+            std::vector<Connection> legs = follow_transfer_pattern(patternStations, stationsInPattern, firstTrip);
+            if (legs.empty())
+            {
+                continue;
+            }
+
+            int arrivalTime = legs.back().arrivalTime;
+            std::tuple<int, int, int> cost = twentyFourTime >= 0 ? std::make_tuple(arrivalTime, -firstTrip.departureTime, firstTrip.lookUpKey)
+                                                                 : std::make_tuple(arrivalTime - firstTrip.departureTime, 0, firstTrip.lookUpKey);
+            if (cost < minimumCost)
+            {
+                minimumCost = cost;
+                bestLegs = legs;
+            }
+        }
+    }
+
+    if (bestLegs.empty())
+    {
+        return {-1, {}};
+    }
+
+    return build_route(bestLegs, destinationID);
+}
+
+void StationGraph::floyd_warshal_shortest_paths(bool includeLayovers)
+{
+    const int INF = Utility::INF;
+    const int vertexCount = departureGraphList->GetVertexCount();
+    // Construct adjacency matrix from adjacencyList as one row-major buffer. If value >= MinPlusKernel::INF, no path exists between start and end index.
+    std::vector<int> distance((size_t)vertexCount * vertexCount, MinPlusKernel::INF);
+    // Next hop for every pair, Utility::INF where no path exists, becomes the sequence table once the kernel is done.
+    std::vector<int> next((size_t)vertexCount * vertexCount, INF);
+
+    for (int startID = 0; startID < vertexCount; startID++)
+    {
+        for (size_t edge = departureGraphList->GetEdgeBegin(startID); edge < departureGraphList->GetEdgeEnd(startID); edge++)
+        {
+            // if not include layovers, only include ride time in weight calculation.
+            int tripWeight = includeLayovers ? departureGraphList->GetWeight(edge) : departureGraphList->GetRideMinutes(edge);
+            int destinationID = departureGraphList->GetDestinationKey(edge);
+            distance[(size_t)startID * vertexCount + destinationID] = tripWeight;
+            next[(size_t)startID * vertexCount + destinationID] = destinationID;
+        }
+    }
+
+    size_t workingBytes = MemoryReport::GetVectorBytes(distance) + MemoryReport::GetVectorBytes(next);
+
+#ifdef VERIFY_SHORTEST_PATHS
+    std::vector<int> referenceDistance = distance;
+    std::vector<int> referenceNext = next;
+    MinPlusKernel::ShortestPathsReference(referenceDistance, referenceNext, vertexCount);
+    workingBytes *= 2;
+
+    // Each forced path relaxes every row itself, so the vector paths are checked even where the sparse shortcut would take over.
+    const std::pair<MinPlusKernel::RelaxPath, const char*> forcedPaths[] = {
+        {MinPlusKernel::RelaxPath::Scalar, "scalar"}, {MinPlusKernel::RelaxPath::Sse, "sse4.1"}, {MinPlusKernel::RelaxPath::Avx2, "avx2"}};
+    for (const std::pair<MinPlusKernel::RelaxPath, const char*>& forcedPath : forcedPaths)
+    {
+        if (!MinPlusKernel::PathSupported(forcedPath.first))
+        {
+            std::cerr << "floyd_warshal_shortest_paths: " << forcedPath.second << " kernel not supported here, not checked\n";
+            continue;
+        }
+
+        std::vector<int> pathDistance = distance;
+        std::vector<int> pathNext = next;
+        MinPlusKernel::ShortestPaths(pathDistance, pathNext, vertexCount, threadCount, forcedPath.first);
+        if (pathDistance != referenceDistance || pathNext != referenceNext)
+        {
+            throw std::runtime_error(std::string("floyd_warshal_shortest_paths: ") + forcedPath.second +
+                " kernel output does not match the reference implementation");
+        }
+    }
+#endif
+
+    long long relaxations = MinPlusKernel::ShortestPaths(distance, next, vertexCount, threadCount);
+    buildProfile.AddCount(includeLayovers ? "floyd_warshal_relaxations_with_layovers" : "floyd_warshal_relaxations_without_layovers", relaxations);
+
+#ifdef VERIFY_SHORTEST_PATHS
+    if (distance != referenceDistance || next != referenceNext)
+    {
+        throw std::runtime_error("floyd_warshal_shortest_paths: kernel output does not match the reference implementation");
+    }
+    std::cerr << "floyd_warshal_shortest_paths: " << vertexCount << " vertices " << (includeLayovers ? "with" : "without")
+              << " layovers, every supported kernel matches the reference implementation\n";
+#endif
+
+    // Sequence table to store shortest paths for future operations, narrowed so it takes half or less of the working buffer.
+    SequenceTable* shortestRouteTable = new SequenceTable(vertexCount, next);
+    floydWarshallWorkingBytes = std::max(floydWarshallWorkingBytes, workingBytes + shortestRouteTable->GetBytes());
+
+    if (includeLayovers)
+    {
+        shortestRouteWithLayoverSequenceTable = shortestRouteTable;
+    }
+    else
+    {
+        shortestRouteWithoutLayoverSequenceTable = shortestRouteTable;
+    }
+}
+
+Route StationGraph::GetShortestRoute(int departureStationID, int destinationStationID, bool includeLayovers)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    Route tripRoute = routeCache ? get_cached_route({departureStationID, destinationStationID, -1, includeLayovers})
+                                 : find_shortest_route(departureStationID, destinationStationID, includeLayovers);
+    add_route_stops(tripRoute);
+    return tripRoute;
+}
+
+Route StationGraph::GetRouteFromTime(int twentyFourTime, int departureStationID, int destinationStationID)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    Route tripRoute = routeCache ? get_cached_route({departureStationID, destinationStationID, twentyFourTime, true})
+                                 : find_route_from_time(twentyFourTime, departureStationID, destinationStationID);
+    add_route_stops(tripRoute);
+    return tripRoute;
+}
+
+void StationGraph::add_route_stops(Route& tripRoute)
+{
+    if (!tripRoute.RouteIsValid())
+    {
+        return;
+    }
+
+    // Trip keys stop at the trip's departure, terminal keys at their station with no departure time, like the graph vertices.
+    const int tripCount = tripList->size();
+    auto stopOf = [&](int key) -> RouteStop
+    {
+        return key < tripCount ? RouteStop{(*tripList)[key].departureStationID, (*tripList)[key].departureTime} : RouteStop{key - tripCount + 1, 0};
+    };
+    tripRoute.stops.reserve(tripRoute.tripList.size() + 1);
+    tripRoute.stops.push_back(stopOf(tripRoute.departureKey));
+    for (const TripPlusLayover& trip : tripRoute.tripList)
+    {
+        tripRoute.stops.push_back(stopOf(trip.destinationKey));
+    }
+}
+
+// Answers from the cache, or runs the query and caches its trips. Invalid routes are cached too, missing routes are asked for as often.
+Route StationGraph::get_cached_route(const RouteCacheKey& key)
+{
+    CachedRoute cached;
+    if (!routeCache->Find(key, cached))
+    {
+        Route foundRoute = key.twentyFourTime < 0 ? find_shortest_route(key.departureStationID, key.destinationStationID, key.includeLayovers)
+                                                  : find_route_from_time(key.twentyFourTime, key.departureStationID, key.destinationStationID);
+        cached.departureKey = foundRoute.RouteIsValid() ? foundRoute.departureKey : -1;
+        cached.tripList = foundRoute.tripList;
+        routeCache->Insert(key, cached);
+        return foundRoute;
+    }
+
+    if (cached.departureKey == -1)
+    {
+        return {-1, {}};
+    }
+    return {cached.departureKey, std::move(cached.tripList)};
+}
+
+const PhaseProfile& StationGraph::GetBuildProfile() const
+{
+    return buildProfile;
+}
+
+MemoryReport StationGraph::GetMemoryReport()
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    MemoryReport report;
+    report.AddStructure("trip_list", MemoryReport::GetVectorBytes(*tripList) + cancelledTrips->capacity() / 8);
+    report.AddStructure("stations_graph", stationsGraphList->GetBytes());
+    report.AddStructure("station_arrivals_graph", stationArrivalsGraphList->GetBytes());
+    if (departureGraphList)
+    {
+        report.AddStructure("departures_graph", departureGraphList->GetBytes());
+        report.AddStructure("departure_key_index", MemoryReport::GetNestedVectorBytes(*departureKeysByStation));
+    }
+    size_t routePatternBytes = MemoryReport::GetVectorBytes(*routePatternList);
+    for (const std::vector<RoutePattern>& stationPatterns : *routePatternList)
+    {
+        routePatternBytes += MemoryReport::GetObjectVectorBytes(stationPatterns);
+    }
+    report.AddStructure("route_patterns", routePatternBytes);
+    report.AddStructure("connections", MemoryReport::GetVectorBytes(*connectionList));
+    report.AddStructure("station_departures", MemoryReport::GetNestedVectorBytes(*stationDepartureList));
+    report.AddStructure("reachability_index", reachableStations->GetBytes() + nonstopStations->GetBytes());
+    if (shortestRouteWithLayoverSequenceTable)
+    {
+        report.AddStructure("sequence_table_with_layovers", shortestRouteWithLayoverSequenceTable->GetBytes());
+        report.AddStructure("sequence_table_without_layovers", shortestRouteWithoutLayoverSequenceTable->GetBytes());
+    }
+    if (transferPatternTable)
+    {
+        report.AddStructure("transfer_patterns", transferPatternTable->GetBytes());
+    }
+    if (shortestPathTreeCache)
+    {
+        report.AddStructure("shortest_path_tree_cache", shortestPathTreeCache->GetBytes());
+    }
+    if (routeCache)
+    {
+        report.AddStructure("route_cache", routeCache->GetBytes());
+    }
+    report.AddCount("floyd_warshal_peak_working_bytes", floydWarshallWorkingBytes);
+    return report;
+}
+
+RouteCacheStats StationGraph::GetRouteCacheStats()
+{
+    if (!routeCache)
+    {
+        return {0, 0, 0, 0};
+    }
+    return routeCache->GetStats();
+}
+
+Route StationGraph::find_shortest_route(int departureStationID, int destinationStationID, bool includeLayovers)
+{
+    if (routeEngine == RouteEngine::ConnectionScan)
+    {
+        return get_shortest_route_by_scan(departureStationID, destinationStationID, includeLayovers, -1);
+    }
+    else if (routeEngine == RouteEngine::Dijkstra)
+    {
+        return get_shortest_route_by_dijkstra(departureStationID, destinationStationID, includeLayovers, -1);
+    }
+    else if (routeEngine == RouteEngine::LazyTrees)
+    {
+        return get_shortest_route_by_tree(departureStationID, destinationStationID, includeLayovers, -1);
+    }
+    else if (routeEngine == RouteEngine::TransferPatterns)
+    {
+        return get_shortest_route_by_patterns(departureStationID, destinationStationID, includeLayovers, -1);
+    }
+    else if (includeLayovers)
+    {
+        return get_shortest_route(departureStationID, destinationStationID, *shortestRouteWithLayoverSequenceTable, true);
+    }
+    else
+    {
+        return get_shortest_route(departureStationID, destinationStationID, *shortestRouteWithoutLayoverSequenceTable, false);
+    }
+}
+
+Route StationGraph::find_route_from_time(int twentyFourTime, int departureStationID, int destinationStationID)
+{
+    if (routeEngine == RouteEngine::ConnectionScan)
+    {
+        return get_shortest_route_by_scan(departureStationID, destinationStationID, true, twentyFourTime);
+    }
+    else if (routeEngine == RouteEngine::Dijkstra)
+    {
+        return get_shortest_route_by_dijkstra(departureStationID, destinationStationID, true, twentyFourTime);
+    }
+    else if (routeEngine == RouteEngine::LazyTrees)
+    {
+        return get_shortest_route_by_tree(departureStationID, destinationStationID, true, twentyFourTime);
+    }
+    else if (routeEngine == RouteEngine::TransferPatterns)
+    {
+        return get_shortest_route_by_patterns(departureStationID, destinationStationID, true, twentyFourTime);
+    }
+
+    return get_shortest_route_from_time(departureStationID, destinationStationID, twentyFourTime);
+}
+
+// Returns the fastest itinerary (layovers included) for each number of transfers up to maxTransfers, ordered by transfers.
+// An itinerary is only listed if it is faster than every itinerary with fewer transfers.
+std::vector<Route> StationGraph::GetRoutesByTransfers(int departureStationID, int destinationStationID, int maxTransfers)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    const int INF = Utility::INF;
+    std::vector<Route> paretoRoutes;
+    if (departureStationID < 1 || departureStationID > stationCount || destinationStationID < 1 || destinationStationID > stationCount || maxTransfers < 0)
+    {
+        return paretoRoutes;
+    }
+
+    // An itinerary can never use more trains than there are in the schedule.
+    int tripCount = tripList->size();
+    int maxRounds = std::min(maxTransfers + 1, tripCount);
+
+    std::vector<int> departureTimes;
+    for (const RoutePattern& pattern : (*routePatternList)[departureStationID - 1])
+    {
+        for (int i = 0; i < pattern.GetTripCount(); i++)
+        {
+            departureTimes.push_back(pattern.GetTrip(i).departureTime);
+        }
+    }
+    std::sort(departureTimes.begin(), departureTimes.end());
+    departureTimes.erase(std::unique(departureTimes.begin(), departureTimes.end()), departureTimes.end());
+
+    // Run the rounds once per departure time and keep the shortest overall travel time found for each round.
+    std::vector<int> fastestByRound(maxRounds + 1, INF);
+    std::vector<std::vector<Connection>> fastestJourneyByRound(maxRounds + 1);
+    std::vector<std::vector<Connection>> journeyByRound;
+    for (int departureTime : departureTimes)
+    {
+        raptor_rounds(departureStationID, destinationStationID, departureTime, maxRounds, journeyByRound);
+        for (int round = 1; round <= maxRounds; round++)
+        {
+            if (!journeyByRound[round].empty() && journeyByRound[round].back().arrivalTime - departureTime < fastestByRound[round])
+            {
+                fastestByRound[round] = journeyByRound[round].back().arrivalTime - departureTime;
+                fastestJourneyByRound[round] = journeyByRound[round];
+            }
+        }
+    }
+
+    int fastestSoFar = INF;
+    for (int round = 1; round <= maxRounds; round++)
+    {
+        if (fastestByRound[round] < fastestSoFar)
+        {
+            fastestSoFar = fastestByRound[round];
+            paretoRoutes.push_back(build_route(fastestJourneyByRound[round], destinationStationID));
+            add_route_stops(paretoRoutes.back());
+        }
+    }
+
+    return paretoRoutes;
+}
+
+std::vector<Route> StationGraph::GetRouteProfile(int departureStationID, int destinationStationID, int windowStart, int windowEnd)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    std::vector<Route> profileRoutes;
+    if (departureStationID < 1 || departureStationID > stationCount || destinationStationID < 1 || destinationStationID > stationCount || windowStart > windowEnd)
+    {
+        return profileRoutes;
+    }
+
+    // One scan gives the earliest arrival at the destination from every train, whatever time it leaves.
+    std::vector<int> bestValue;
+    std::vector<int> nextConnection;
+    connection_scan(destinationStationID, true, bestValue, nextConnection);
+
+    // Walking back from the latest departure, a train is only kept if it arrives earlier than everything leaving after it. Trains
+    // leaving at the same time replace each other, ties go to the lowest lookUpKey like get_shortest_route_by_scan.
+    int earliestArrival = Utility::INF;
+    std::vector<int> firstConnections;
+    for (int i = (int)connectionList->size() - 1; i >= 0; i--)
+    {
+        const Connection& current = (*connectionList)[i];
+        if (current.departureStationID != departureStationID || current.departureTime < windowStart || current.departureTime > windowEnd)
+        {
+            continue;
+        }
+
+        bool sameDeparture = !firstConnections.empty() && (*connectionList)[firstConnections.back()].departureTime == current.departureTime;
+        if (bestValue[i] < earliestArrival || (sameDeparture && bestValue[i] == earliestArrival))
+        {
+            if (sameDeparture)
+            {
+                firstConnections.pop_back();
+            }
+            firstConnections.push_back(i);
+            earliestArrival = bestValue[i];
+        }
+    }
+
+    for (auto first = firstConnections.rbegin(); first != firstConnections.rend(); first++)
+    {
+        std::vector<Connection> legs;
+        for (int i = *first; i != -1; i = nextConnection[i])
+        {
+            legs.push_back((*connectionList)[i]);
+        }
+        profileRoutes.push_back(build_route(legs, destinationStationID));
+        add_route_stops(profileRoutes.back());
+    }
+
+    return profileRoutes;
+}
+
+std::vector<Connection> StationGraph::GetDepartureBoard(int stationID, int twentyFourTime, int count)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    if (stationID < 1 || stationID > stationCount || count <= 0)
+    {
+        return {};
+    }
+
+    const std::vector<Connection>& departures = (*stationDepartureList)[stationID - 1];
+    auto firstDeparture = std::partition_point(departures.begin(), departures.end(),
+        [twentyFourTime](const Connection& trip) { return trip.departureTime < twentyFourTime; });
+    auto lastDeparture = firstDeparture + std::min<long>(count, departures.end() - firstDeparture);
+    return std::vector<Connection>(firstDeparture, lastDeparture);
+}
+
+int StationGraph::GetVertexCount()
+{
+    return stationCount;
+}
+
+void StationGraph::WriteCompiled(const std::string& path, const std::vector<StationRecord>& stationData, const std::vector<Connection>& tripData)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    if (!shortestRouteWithLayoverSequenceTable || !shortestRouteWithoutLayoverSequenceTable)
+    {
+        throw std::runtime_error("compiling a timetable needs the sequence tables of the floyd warshal engine");
+    }
+    if (timetableUpdated)
+    {
+        // The compiled format has no room for cancelled trains.
+        throw std::runtime_error("a timetable changed at runtime can't be compiled, compile the updated data files instead");
+    }
+
+    CompiledTimetable::Write(path, stationData, tripData, *departureGraphList, *shortestRouteWithLayoverSequenceTable, *shortestRouteWithoutLayoverSequenceTable);
+}
+
+Station StationGraph::GetStationFromGraph(int stationID)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    int iDAsZeroIndex = stationID - 1;
+    if (iDAsZeroIndex < stationsGraphList->GetStationCount() && iDAsZeroIndex >= 0)
+    {
+        return stationsGraphList->GetStation(stationID);
+    }
+    else
+    {
+        // return invalid station if bad station ID
+        return Station(-1, nullptr, nullptr, nullptr, 0);
+    }
+}
+
+Departure StationGraph::GetDepartureFromGraph(int lookUpKey)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    if (!departureGraphList)
+    {
+        throw std::runtime_error("the departure graph is only built for the floyd warshal and lazy tree engines");
+    }
+    return departureGraphList->GetDeparture(lookUpKey);
+}
+
+bool StationGraph::HasDepartureGraph()
+{
+    return departureGraphList != nullptr;
+}
+
+// Duplication of code between two graph types. Might want to pull this out to be more
+// generic.
+Station StationGraph::GetStationFromArrivalGraph(int stationID)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    int iDAsZeroIndex = stationID - 1;
+    if (iDAsZeroIndex < stationArrivalsGraphList->GetStationCount() && iDAsZeroIndex >= 0)
+    {
+        return stationArrivalsGraphList->GetStation(stationID);
+    }
+    else
+    {
+        // return invalid station if bad station ID
+        return Station(-1, nullptr, nullptr, nullptr, 0);
+    }
+}
+
+bool StationGraph::PathExists(int startStationID, int targetStationID)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    return reachableStations->Contains(startStationID, targetStationID);
+}
+
+bool StationGraph::DirectPathExists(int startStationID, int targetStationID)
+{
+    std::shared_lock<std::shared_mutex> guard(graphLock);
+    return nonstopStations->Contains(startStationID, targetStationID);
+}
+
+int StationGraph::AddTrain(int departureStationID, int arrivalStationID, int departureTime, int arrivalTime)
+{
+    std::unique_lock<std::shared_mutex> guard(graphLock);
+    if (departureStationID < 1 || departureStationID > stationCount || arrivalStationID < 1 || arrivalStationID > stationCount ||
+        shift_time(departureTime, 0) < 0 || shift_time(arrivalTime, 0) < 0 || arrivalTime < departureTime)
+    {
+        return -1;
+    }
+
+    int lookUpKey = tripList->size();
+    tripList->push_back({lookUpKey, departureStationID, arrivalStationID, departureTime, arrivalTime});
+    cancelledTrips->push_back(false);
+    insert_trip_vertex(lookUpKey);
+    update_trip(lookUpKey, nullptr);
+    return lookUpKey;
+}
+
+bool StationGraph::CancelTrain(int trainNumber)
+{
+    std::unique_lock<std::shared_mutex> guard(graphLock);
+    if (trainNumber < 0 || trainNumber >= tripList->size() || (*cancelledTrips)[trainNumber])
+    {
+        return false;
+    }
+
+    (*cancelledTrips)[trainNumber] = true;
+    Connection previousRecord = (*tripList)[trainNumber];
+    update_trip(trainNumber, &previousRecord);
+    return true;
+}
+
+bool StationGraph::DelayTrain(int trainNumber, int delayMinutes)
+{
+    std::unique_lock<std::shared_mutex> guard(graphLock);
+    if (trainNumber < 0 || trainNumber >= tripList->size() || (*cancelledTrips)[trainNumber])
+    {
+        return false;
+    }
+
+    Connection previousRecord = (*tripList)[trainNumber];
+    int departureTime = shift_time(previousRecord.departureTime, delayMinutes);
+    int arrivalTime = shift_time(previousRecord.arrivalTime, delayMinutes);
+    if (departureTime < 0 || arrivalTime < 0)
+    {
+        return false;
+    }
+
+    (*tripList)[trainNumber].departureTime = departureTime;
+    (*tripList)[trainNumber].arrivalTime = arrivalTime;
+    update_trip(trainNumber, &previousRecord);
+    return true;
+}
+
+// Adds minutes to an HHMM time, -1 if the time is not a valid HHMM or the result leaves the day.
+int StationGraph::shift_time(int twentyFourTime, int minutes)
+{
+    if (twentyFourTime < 0 || twentyFourTime % 100 >= 60 || twentyFourTime >= 2400)
+    {
+        return -1;
+    }
+
+    int dayMinutes = twentyFourTime / 100 * 60 + twentyFourTime % 100 + minutes;
+    if (dayMinutes < 0 || dayMinutes >= 24 * 60)
+    {
+        return -1;
+    }
+    return dayMinutes / 60 * 100 + dayMinutes % 60;
+}
+
+// Makes room for a new trip vertex at lookUpKey, which is always the first terminal key, so the terminal vertices and every edge
+// into them move up by one. The sequence tables get an empty row and column, update_trip fills them in.
+void StationGraph::insert_trip_vertex(int lookUpKey)
+{
+    const Connection& record = (*tripList)[lookUpKey];
+    if (departureGraphList)
+    {
+        departureGraphList->InsertVertex(lookUpKey, record.departureStationID, record.departureTime);
+    }
+
+    if (shortestRouteWithLayoverSequenceTable)
+    {
+        shortestRouteWithLayoverSequenceTable->InsertVertex(lookUpKey);
+        shortestRouteWithoutLayoverSequenceTable->InsertVertex(lookUpKey);
+    }
+}
+
+// Brings every structure in line with the current record of lookUpKey, previousRecord is what the other structures were built
+// from and is null for a new trip. Only the vertices whose edges change are rebuilt: the trip itself, the trips sharing its record
+// before and after (their edges are shared) and the trips arriving early enough to connect to it. Sequence table rows only change
+// for vertices that reach one of those, paths that don't touch a changed vertex keep their weights. Likewise the reachability rows
+// and transfer patterns are only recomputed for the stations whose journeys could take the trip.
+void StationGraph::update_trip(int lookUpKey, const Connection* previousRecord)
+{
+    timetableUpdated = true;
+    update_station_lists(lookUpKey, previousRecord);
+
+    if (departureGraphList)
+    {
+        std::vector<int> changedKeys = {lookUpKey};
+        if (previousRecord)
+        {
+            collect_changed_departures(*previousRecord, changedKeys);
+        }
+        if (!(*cancelledTrips)[lookUpKey])
+        {
+            collect_changed_departures((*tripList)[lookUpKey], changedKeys);
+        }
+        std::sort(changedKeys.begin(), changedKeys.end());
+        changedKeys.erase(std::unique(changedKeys.begin(), changedKeys.end()), changedKeys.end());
+
+        std::vector<std::vector<TripPlusLayover>> edgeLists;
+        for (int key : changedKeys)
+        {
+            edgeLists.push_back(build_departure(key));
+        }
+        departureGraphList->ReplaceEdges(changedKeys, edgeLists);
+        // A delay moves the trip's own departure, the other changed vertices only get new edges.
+        const Connection& record = (*tripList)[lookUpKey];
+        departureGraphList->SetVertex(lookUpKey, record.departureStationID, record.departureTime);
+
+        if (shortestRouteWithLayoverSequenceTable)
+        {
+            // A path reaching a changed vertex in the new graph reaches one in the old graph as well, its first changed vertex is
+            // reached over unchanged edges, so the ancestors in the new graph cover both.
+            std::vector<char> affectedRows;
+            collect_route_ancestors(changedKeys, affectedRows);
+            repair_sequence_rows(affectedRows);
+        }
+    }
+    if (shortestPathTreeCache)
+    {
+        shortestPathTreeCache->Clear();
+    }
+
+    // Only journeys that could take the trip before or after the change are affected, they leave from the stations reaching its
+    // departure in time and go to the stations reachable after its arrival. Journeys between other pairs keep their answers.
+    std::vector<std::pair<int, int>> tripDepartures;
+    std::vector<std::pair<int, int>> tripArrivals;
+    if (previousRecord)
+    {
+        tripDepartures.push_back({previousRecord->departureStationID, previousRecord->departureTime});
+        tripArrivals.push_back({previousRecord->arrivalStationID, previousRecord->arrivalTime});
+    }
+    if (!(*cancelledTrips)[lookUpKey])
+    {
+        tripDepartures.push_back({(*tripList)[lookUpKey].departureStationID, (*tripList)[lookUpKey].departureTime});
+        tripArrivals.push_back({(*tripList)[lookUpKey].arrivalStationID, (*tripList)[lookUpKey].arrivalTime});
+    }
+    std::vector<char> affectedDepartures;
+    collect_stations_reaching(tripDepartures, affectedDepartures);
+    repair_reachability_rows(affectedDepartures);
+    for (const std::pair<int, int>& departure : tripDepartures)
+    {
+        nonstopStations->ClearRow(departure.first);
+        for (const Connection& trip : (*stationDepartureList)[departure.first - 1])
+        {
+            nonstopStations->Add(departure.first, trip.arrivalStationID);
+        }
+    }
+
+    if (transferPatternTable)
+    {
+        std::vector<char> affectedDestinations;
+        collect_stations_reached(tripArrivals, affectedDestinations);
+        transferPatternTable->ReplacePairs(affectedDepartures, affectedDestinations);
+        std::vector<int> bestValue;
+        std::vector<int> nextConnection;
+        for (int destinationID = 1; destinationID <= stationCount; destinationID++)
+        {
+            if (affectedDestinations[destinationID])
+            {
+                add_transfer_patterns(destinationID, affectedDepartures, bestValue, nextConnection);
+            }
+        }
+        transferPatternTable->Freeze();
+    }
+    if (routeCache)
+    {
+        routeCache->Clear();
+    }
+}
+
+// Removes previousRecord from the per station lists and adds the current record unless the trip is cancelled. Lists that are
+// sorted keep file order within a time, like the stable sorts that built them.
+void StationGraph::update_station_lists(int lookUpKey, const Connection* previousRecord)
+{
+    const Connection& trip = (*tripList)[lookUpKey];
+    bool cancelled = (*cancelledTrips)[lookUpKey];
+    auto timeThenKey = [](const Connection& a, const Connection& b)
+    {
+        return std::tie(a.departureTime, a.lookUpKey) < std::tie(b.departureTime, b.lookUpKey);
+    };
+    auto sameKey = [lookUpKey](const Connection& c) { return c.lookUpKey == lookUpKey; };
+
+    if (previousRecord)
+    {
+        connectionList->erase(std::find_if(connectionList->begin(), connectionList->end(), sameKey));
+        std::vector<Connection>& departures = (*stationDepartureList)[previousRecord->departureStationID - 1];
+        departures.erase(std::find_if(departures.begin(), departures.end(), sameKey));
+    }
+    if (!cancelled)
+    {
+        connectionList->insert(std::upper_bound(connectionList->begin(), connectionList->end(), trip, timeThenKey), trip);
+        std::vector<Connection>& departures = (*stationDepartureList)[trip.departureStationID - 1];
+        departures.insert(std::upper_bound(departures.begin(), departures.end(), trip, timeThenKey), trip);
+    }
+
+    // The remaining lists are small per station, the touched stations are rebuilt from the trips in file order.
+    std::vector<int> departureStations = {trip.departureStationID};
+    std::vector<int> arrivalStations = {trip.arrivalStationID};
+    if (previousRecord)
+    {
+        departureStations.push_back(previousRecord->departureStationID);
+        arrivalStations.push_back(previousRecord->arrivalStationID);
+    }
+
+    for (int stationID : departureStations)
+    {
+        if (departureKeysByStation)
+        {
+            std::vector<int>& departureKeys = (*departureKeysByStation)[stationID - 1];
+            departureKeys.clear();
+            for (const Connection& departure : (*stationDepartureList)[stationID - 1])
+            {
+                departureKeys.push_back(departure.lookUpKey);
+            }
+        }
+
+        std::vector<Trip> stationTrips;
+        (*routePatternList)[stationID - 1].clear();
+        for (int i = 0; i < tripList->size(); i++)
+        {
+            const Connection& current = (*tripList)[i];
+            if (!(*cancelledTrips)[i] && current.departureStationID == stationID)
+            {
+                stationTrips.push_back({current.arrivalStationID, current.departureTime, current.arrivalTime});
+                add_to_route_patterns(current);
+            }
+        }
+        std::stable_sort(stationTrips.begin(), stationTrips.end(),
+            [](const Trip& a, const Trip& b) { return a.departureTime < b.departureTime; });
+        stationsGraphList->ReplaceTrips(stationID, stationTrips);
+        for (RoutePattern& pattern : (*routePatternList)[stationID - 1])
+        {
+            pattern.SortTrips();
+        }
+    }
+
+    for (int stationID : arrivalStations)
+    {
+        std::vector<Trip> stationTrips;
+        for (int i = 0; i < tripList->size(); i++)
+        {
+            const Connection& current = (*tripList)[i];
+            if (!(*cancelledTrips)[i] && current.arrivalStationID == stationID)
+            {
+                stationTrips.push_back({current.departureStationID, current.arrivalTime, current.departureTime});
+            }
+        }
+        std::stable_sort(stationTrips.begin(), stationTrips.end(),
+            [](const Trip& a, const Trip& b) { return a.departureTime < b.departureTime; });
+        stationArrivalsGraphList->ReplaceTrips(stationID, stationTrips);
+    }
+}
+
+// Adds the trips whose edges depend on a trip with this record: the ones sharing the record and the ones that can connect to it.
+void StationGraph::collect_changed_departures(const Connection& record, std::vector<int>& changedKeys)
+{
+    for (const Connection& departure : (*stationDepartureList)[record.departureStationID - 1])
+    {
+        if (departure.departureTime == record.departureTime && departure.arrivalStationID == record.arrivalStationID &&
+            departure.arrivalTime == record.arrivalTime)
+        {
+            changedKeys.push_back(departure.lookUpKey);
+        }
+    }
+
+    for (int i = 0; i < tripList->size(); i++)
+    {
+        const Connection& current = (*tripList)[i];
+        if (!(*cancelledTrips)[i] && current.arrivalStationID == record.departureStationID && current.arrivalTime < record.departureTime)
+        {
+            changedKeys.push_back(i);
+        }
+    }
+}
+
+// Same edges build_departures_graph gives lookUpKey, taken from the current station departure lists. Cancelled trips keep their
+// vertex with no edges, nothing points at them and no route starts from them.
+std::vector<TripPlusLayover> StationGraph::build_departure(int lookUpKey)
+{
+    const Connection& record = (*tripList)[lookUpKey];
+    if ((*cancelledTrips)[lookUpKey])
+    {
+        return {};
+    }
+
+    int tripCount = (int)departureGraphList->GetVertexCount() - stationCount;
+    std::vector<int> groupKeys;
+    for (const Connection& departure : (*stationDepartureList)[record.departureStationID - 1])
+    {
+        if (departure.departureTime == record.departureTime && departure.arrivalStationID == record.arrivalStationID &&
+            departure.arrivalTime == record.arrivalTime)
+        {
+            groupKeys.push_back(departure.lookUpKey);
+        }
+    }
+    std::sort(groupKeys.begin(), groupKeys.end());
+
+    std::vector<TripPlusLayover> groupEdges;
+    std::vector<int> connectingTrips;
+    for (int memberKey : groupKeys)
+    {
+        int rideTimeToDestination = record.arrivalTime - record.departureTime;
+        groupEdges.push_back({record.arrivalStationID + (tripCount - 1), rideTimeToDestination, 0, rideTimeToDestination});
+
+        connectingTrips.clear();
+        const std::vector<Connection>& departures = (*stationDepartureList)[record.arrivalStationID - 1];
+        auto firstConnection = std::partition_point(departures.begin(), departures.end(),
+            [&record](const Connection& trip) { return trip.departureTime <= record.arrivalTime; });
+        for (auto j = firstConnection; j != departures.end(); j++)
+        {
+            if (j->lookUpKey != memberKey)
+            {
+                connectingTrips.push_back(j->lookUpKey);
+            }
+        }
+
+        std::sort(connectingTrips.begin(), connectingTrips.end());
+        for (int j : connectingTrips)
+        {
+            int layoverAtDestination = (*tripList)[j].departureTime - record.arrivalTime;
+            groupEdges.push_back({get_last_matching_key((*tripList)[j]), rideTimeToDestination, layoverAtDestination,
+                rideTimeToDestination + layoverAtDestination});
+        }
+    }
+
+    return groupEdges;
+}
+
+// Highest key among the running trips with the same record, edges into a group of identical records point at it.
+int StationGraph::get_last_matching_key(const Connection& record)
+{
+    int lastKey = record.lookUpKey;
+    const std::vector<Connection>& departures = (*stationDepartureList)[record.departureStationID - 1];
+    auto departure = std::partition_point(departures.begin(), departures.end(),
+        [&record](const Connection& trip) { return trip.departureTime < record.departureTime; });
+    for (; departure != departures.end() && departure->departureTime == record.departureTime; departure++)
+    {
+        if (departure->arrivalStationID == record.arrivalStationID && departure->arrivalTime == record.arrivalTime)
+        {
+            lastKey = std::max(lastKey, departure->lookUpKey);
+        }
+    }
+    return lastKey;
+}
+
+// Marks keys and every trip with a path to one of them. A trip connects to the departures leaving its arrival station after it
+// arrives, so walking the connections from the latest to the earliest, a trip reaches a marked one when it arrives before the
+// latest marked departure from its arrival station. That also marks the odd trip the graph doesn't link, like a group member no
+// edge points at, which only costs a row repair that changes nothing.
+void StationGraph::collect_route_ancestors(const std::vector<int>& keys, std::vector<char>& isAncestor)
+{
+    isAncestor.assign(departureGraphList->GetVertexCount(), 0);
+    for (int key : keys)
+    {
+        isAncestor[key] = 1;
+    }
+
+    std::vector<int> latestMarkedDeparture(stationCount + 1, -1);
+    for (int i = (int)connectionList->size() - 1; i >= 0; i--)
+    {
+        const Connection& current = (*connectionList)[i];
+        if (current.arrivalTime < latestMarkedDeparture[current.arrivalStationID])
+        {
+            isAncestor[current.lookUpKey] = 1;
+        }
+        if (isAncestor[current.lookUpKey])
+        {
+            latestMarkedDeparture[current.departureStationID] = std::max(latestMarkedDeparture[current.departureStationID], current.departureTime);
+        }
+    }
+}
+
+// Marks the station of every (station, time) target and every station with a journey arriving at a target before its time, walking
+// the connections from the latest to the earliest like collect_route_ancestors.
+void StationGraph::collect_stations_reaching(const std::vector<std::pair<int, int>>& targets, std::vector<char>& isReaching)
+{
+    isReaching.assign(stationCount + 1, 0);
+    std::vector<int> latestDeparture(stationCount + 1, -1);
+    for (const std::pair<int, int>& target : targets)
+    {
+        isReaching[target.first] = 1;
+        latestDeparture[target.first] = std::max(latestDeparture[target.first], target.second);
+    }
+
+    for (int i = (int)connectionList->size() - 1; i >= 0; i--)
+    {
+        const Connection& current = (*connectionList)[i];
+        if (current.arrivalTime < latestDeparture[current.arrivalStationID])
+        {
+            isReaching[current.departureStationID] = 1;
+            latestDeparture[current.departureStationID] = std::max(latestDeparture[current.departureStationID], current.departureTime);
+        }
+    }
+}
+
+// Marks the station of every (station, time) source and every station a journey leaving a source after its time arrives at.
+void StationGraph::collect_stations_reached(const std::vector<std::pair<int, int>>& sources, std::vector<char>& isReached)
+{
+    isReached.assign(stationCount + 1, 0);
+    std::vector<int> earliestArrival(stationCount + 1, Utility::INF);
+    for (const std::pair<int, int>& source : sources)
+    {
+        isReached[source.first] = 1;
+        earliestArrival[source.first] = std::min(earliestArrival[source.first], source.second);
+    }
+
+    for (const Connection& current : *connectionList)
+    {
+        if (earliestArrival[current.departureStationID] < current.departureTime)
+        {
+            isReached[current.arrivalStationID] = 1;
+            earliestArrival[current.arrivalStationID] = std::min(earliestArrival[current.arrivalStationID], current.arrivalTime);
+        }
+    }
+}
+
+// Recomputes the reachability rows of the marked stations. One walk over the connections in departure order carries a bit for
+// each marked station able to board the train, the trains arriving at a station before a departure leaves hand their bits on
+// to it. A station is reachable from the origins with a bit on a train arriving there.
+void StationGraph::repair_reachability_rows(const std::vector<char>& affectedStations)
+{
+    std::vector<int> origins;
+    std::vector<int> originBit(stationCount + 1, -1);
+    for (int stationID = 1; stationID <= stationCount; stationID++)
+    {
+        if (affectedStations[stationID])
+        {
+            originBit[stationID] = origins.size();
+            origins.push_back(stationID);
+        }
+    }
+    if (origins.empty())
+    {
+        return;
+    }
+
+    const int words = (origins.size() + 63) / 64;
+    const int connectionCount = connectionList->size();
+    // Connections by arrival time, counted out over the HHMM times of the day.
+    std::vector<int> timeOffsets(2400 + 1, 0);
+    for (const Connection& connection : *connectionList)
+    {
+        timeOffsets[connection.arrivalTime + 1]++;
+    }
+    for (int time = 0; time < 2400; time++)
+    {
+        timeOffsets[time + 1] += timeOffsets[time];
+    }
+    std::vector<int> arrivalOrder(connectionCount);
+    for (int i = 0; i < connectionCount; i++)
+    {
+        arrivalOrder[timeOffsets[(*connectionList)[i].arrivalTime]++] = i;
+    }
+
+    std::vector<uint64_t> boardingOrigins((size_t)connectionCount * words, 0);
+    std::vector<uint64_t> arrivedOrigins((size_t)(stationCount + 1) * words, 0);
+    std::vector<uint64_t> reachedFrom((size_t)(stationCount + 1) * words, 0);
+    int nextArrival = 0;
+    for (int i = 0; i < connectionCount; i++)
+    {
+        const Connection& current = (*connectionList)[i];
+        // Trains arriving before this one leaves also left before it, their bits are final.
+        for (; nextArrival < connectionCount && (*connectionList)[arrivalOrder[nextArrival]].arrivalTime < current.departureTime; nextArrival++)
+        {
+            const Connection& arrived = (*connectionList)[arrivalOrder[nextArrival]];
+            const uint64_t* arrivedBits = boardingOrigins.data() + (size_t)arrivalOrder[nextArrival] * words;
+            uint64_t* stationBits = arrivedOrigins.data() + (size_t)arrived.arrivalStationID * words;
+            for (int w = 0; w < words; w++)
+            {
+                stationBits[w] |= arrivedBits[w];
+            }
+        }
+
+        uint64_t* boardingBits = boardingOrigins.data() + (size_t)i * words;
+        const uint64_t* departureBits = arrivedOrigins.data() + (size_t)current.departureStationID * words;
+        uint64_t* reachedBits = reachedFrom.data() + (size_t)current.arrivalStationID * words;
+        std::copy(departureBits, departureBits + words, boardingBits);
+        if (originBit[current.departureStationID] != -1)
+        {
+            int bit = originBit[current.departureStationID];
+            boardingBits[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+        for (int w = 0; w < words; w++)
+        {
+            reachedBits[w] |= boardingBits[w];
+        }
+    }
+
+    for (int bit = 0; bit < origins.size(); bit++)
+    {
+        reachableStations->ClearRow(origins[bit]);
+        for (int stationID = 1; stationID <= stationCount; stationID++)
+        {
+            if ((reachedFrom[(size_t)stationID * words + bit / 64] >> (bit % 64)) & 1)
+            {
+                reachableStations->Add(origins[bit], stationID);
+            }
+        }
+    }
+}
+
+// Departure graph vertices ordered so every edge goes forward. Connections leave after the train arrives, so the connections
+// in departure order are one. Cancelled trips have no edges and terminal vertices none leaving, they go last.
+std::vector<int> StationGraph::topological_order()
+{
+    const int tripCount = tripList->size();
+    std::vector<int> order;
+    order.reserve(departureGraphList->GetVertexCount());
+    for (const Connection& connection : *connectionList)
+    {
+        order.push_back(connection.lookUpKey);
+    }
+    for (int key = 0; key < tripCount; key++)
+    {
+        if ((*cancelledTrips)[key])
+        {
+            order.push_back(key);
+        }
+    }
+    for (int key = tripCount; key < departureGraphList->GetVertexCount(); key++)
+    {
+        order.push_back(key);
+    }
+    return order;
+}
+
+// Recomputes the marked rows of both sequence tables, the next stop towards each vertex is the first hop of its shortest path.
+// Every edge leads to a later departure, so each row is one relaxation pass over the vertices in topological order rather than
+// a Dijkstra. Other rows still hold shortest paths, so walks that leave a repaired row stay shortest.
+void StationGraph::repair_sequence_rows(const std::vector<char>& affectedRows)
+{
+    const int INF = Utility::INF;
+    const int vertexCount = departureGraphList->GetVertexCount();
+
+    std::vector<int> topologicalOrder = topological_order();
+    std::vector<int> orderPosition(vertexCount);
+    for (int i = 0; i < topologicalOrder.size(); i++)
+    {
+        orderPosition[topologicalOrder[i]] = i;
+    }
+
+    // Both tables share the pass, a vertex is reachable or not whatever the weights.
+    std::vector<int> withLayoverDistance(vertexCount);
+    std::vector<int> withoutLayoverDistance(vertexCount);
+    std::vector<int> withLayoverFirstHop(vertexCount);
+    std::vector<int> withoutLayoverFirstHop(vertexCount);
+    for (int fromKey = 0; fromKey < vertexCount; fromKey++)
+    {
+        if (!affectedRows[fromKey])
+        {
+            continue;
+        }
+
+        withLayoverDistance.assign(vertexCount, INF);
+        withoutLayoverDistance.assign(vertexCount, INF);
+        withLayoverFirstHop.assign(vertexCount, INF);
+        withoutLayoverFirstHop.assign(vertexCount, INF);
+        withLayoverDistance[fromKey] = 0;
+        withoutLayoverDistance[fromKey] = 0;
+
+        for (int i = orderPosition[fromKey]; i < topologicalOrder.size(); i++)
+        {
+            int currentKey = topologicalOrder[i];
+            if (withLayoverDistance[currentKey] == INF)
+            {
+                continue;
+            }
+
+            for (size_t edge = departureGraphList->GetEdgeBegin(currentKey); edge < departureGraphList->GetEdgeEnd(currentKey); edge++)
+            {
+                int nextKey = departureGraphList->GetDestinationKey(edge);
+                int withLayover = withLayoverDistance[currentKey] + departureGraphList->GetWeight(edge);
+                if (withLayover < withLayoverDistance[nextKey])
+                {
+                    withLayoverDistance[nextKey] = withLayover;
+                    withLayoverFirstHop[nextKey] = currentKey == fromKey ? nextKey : withLayoverFirstHop[currentKey];
+                }
+                int withoutLayover = withoutLayoverDistance[currentKey] + departureGraphList->GetRideMinutes(edge);
+                if (withoutLayover < withoutLayoverDistance[nextKey])
+                {
+                    withoutLayoverDistance[nextKey] = withoutLayover;
+                    withoutLayoverFirstHop[nextKey] = currentKey == fromKey ? nextKey : withoutLayoverFirstHop[currentKey];
+                }
+            }
+        }
+
+        shortestRouteWithLayoverSequenceTable->SetRow(fromKey, withLayoverFirstHop);
+        shortestRouteWithoutLayoverSequenceTable->SetRow(fromKey, withoutLayoverFirstHop);
+    }
 }
@@ -0,0 +1,109 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <memory_resource>
+#include "trip.hpp"
+#include "station.hpp"
+#include "graph_arena.hpp"
+
+// Trips of every station in compressed sparse row form, used for both the station graph (trains leaving each station) and the
+// inverted arrivals graph. Station i + 1 holds trips tripOffsets[i] up to tripOffsets[i + 1] and each field has its own array.
+// Stations are added in id order while building. The arrays share one GraphArena block sized by Reserve, replacing the trips of
+// a station rebuilds the table into a fresh arena and releases the old one whole.
+class StationTripTable {
+    public:
+        int GetStationCount() const;
+        // View of the station and its trips, valid until the table changes.
+        Station GetStation(int stationID) const;
+        // Starts the table over with one arena block holding arrays sized for stationCount stations and tripCount trips, so
+        // building it doesn't reallocate or leave slack.
+        void Reserve(int stationCount, int tripCount);
+        void AddStation(const Trip* trips, int tripCount);
+        // Replaces the trips of stationID, the trips of the later stations move along.
+        void ReplaceTrips(int stationID, const std::vector<Trip>& trips);
+        size_t GetBytes() const;
+        StationTripTable();
+    private:
+        // The table's arrays and the arena they are carved from, replaced together by Reserve.
+        struct Arrays {
+            GraphArena arena;
+            std::pmr::vector<int> tripOffsets{&arena};
+            std::pmr::vector<int> destinationIDs{&arena};
+            std::pmr::vector<int> departureTimes{&arena};
+            std::pmr::vector<int> arrivalTimes{&arena};
+            Arrays(size_t bytes) : arena(bytes) {}
+        };
+        std::unique_ptr<Arrays> arrays;
+};
+
+StationTripTable::StationTripTable()
+{
+    Reserve(0, 0);
+}
+
+int StationTripTable::GetStationCount() const
+{
+    return arrays->tripOffsets.size() - 1;
+}
+
+Station StationTripTable::GetStation(int stationID) const
+{
+    const Arrays& table = *arrays;
+    int trip = table.tripOffsets[stationID - 1];
+    return {stationID, table.destinationIDs.data() + trip, table.departureTimes.data() + trip, table.arrivalTimes.data() + trip,
+        table.tripOffsets[stationID] - trip};
+}
+
+void StationTripTable::Reserve(int stationCount, int tripCount)
+{
+    // Room for the four arrays plus the padding that aligns each of them.
+    size_t bytes = ((size_t)stationCount + 1 + (size_t)tripCount * 3) * sizeof(int) + 4 * alignof(std::max_align_t);
+    arrays.reset(new Arrays(bytes));
+    arrays->tripOffsets.reserve(stationCount + 1);
+    arrays->destinationIDs.reserve(tripCount);
+    arrays->departureTimes.reserve(tripCount);
+    arrays->arrivalTimes.reserve(tripCount);
+    arrays->tripOffsets.push_back(0);
+}
+
+void StationTripTable::AddStation(const Trip* trips, int tripCount)
+{
+    for (int i = 0; i < tripCount; i++)
+    {
+        arrays->destinationIDs.push_back(trips[i].destinationID);
+        arrays->departureTimes.push_back(trips[i].departureTime);
+        arrays->arrivalTimes.push_back(trips[i].arrivalTime);
+    }
+    arrays->tripOffsets.push_back(arrays->destinationIDs.size());
+}
+
+void StationTripTable::ReplaceTrips(int stationID, const std::vector<Trip>& trips)
+{
+    std::unique_ptr<Arrays> replaced = std::move(arrays);
+    int stationCount = replaced->tripOffsets.size() - 1;
+    int removedTrips = replaced->tripOffsets[stationID] - replaced->tripOffsets[stationID - 1];
+    Reserve(stationCount, replaced->destinationIDs.size() - removedTrips + trips.size());
+
+    for (int i = 1; i <= stationCount; i++)
+    {
+        if (i == stationID)
+        {
+            AddStation(trips.data(), trips.size());
+            continue;
+        }
+
+        for (int trip = replaced->tripOffsets[i - 1]; trip < replaced->tripOffsets[i]; trip++)
+        {
+            arrays->destinationIDs.push_back(replaced->destinationIDs[trip]);
+            arrays->departureTimes.push_back(replaced->departureTimes[trip]);
+            arrays->arrivalTimes.push_back(replaced->arrivalTimes[trip]);
+        }
+        arrays->tripOffsets.push_back(arrays->destinationIDs.size());
+    }
+}
+
+size_t StationTripTable::GetBytes() const
+{
+    return sizeof(StationTripTable) + sizeof(Arrays) + arrays->arena.GetReservedBytes();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+
+// Reusable barrier, every thread calling Wait blocks until threadCount threads have called it, then all are released together.
+class ThreadBarrier {
+    public:
+        void Wait();
+        ThreadBarrier(int threads);
+    private:
+        std::mutex barrierLock;
+        std::condition_variable released;
+        int threadCount;
+        int waitingCount;
+        // Incremented each time the barrier opens so a thread can tell its own release from a later one.
+        int generation;
+};
+
+ThreadBarrier::ThreadBarrier(int threads)
+{
+    threadCount = threads;
+    waitingCount = 0;
+    generation = 0;
+}
+
+void ThreadBarrier::Wait()
+{
+    std::unique_lock<std::mutex> guard(barrierLock);
+    int arrivedGeneration = generation;
+
+    if (++waitingCount == threadCount)
+    {
+        waitingCount = 0;
+        generation++;
+        released.notify_all();
+    }
+    else
+    {
+        released.wait(guard, [this, arrivedGeneration] { return generation != arrivedGeneration; });
+    }
+}
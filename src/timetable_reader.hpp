@@ -0,0 +1,297 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <charconv>
+#include <stdexcept>
+#include <cctype>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "trip.hpp"
+
+struct StationRecord {
+    int stationID;
+    std::string name;
+};
+
+// Read-only memory mapping of a whole file. Throws std::runtime_error if the file can't be opened or mapped.
+// sequentialAccess tells the kernel to read ahead, turn it off for files that are read at random.
+class MappedFile {
+    public:
+        const char* GetData() const;
+        size_t GetSize() const;
+        MappedFile(const std::string& path, bool sequentialAccess = true);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+    private:
+        const char* data;
+        size_t size;
+};
+
+MappedFile::MappedFile(const std::string& path, bool sequentialAccess)
+{
+    data = nullptr;
+    size = 0;
+
+    int fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor == -1)
+    {
+        throw std::runtime_error(path + ": could not open file");
+    }
+
+    struct stat fileInfo;
+    if (fstat(fileDescriptor, &fileInfo) == -1)
+    {
+        close(fileDescriptor);
+        throw std::runtime_error(path + ": could not read file size");
+    }
+
+    size = fileInfo.st_size;
+    // Zero length mappings are not allowed, an empty file simply has no data.
+    if (size > 0)
+    {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(fileDescriptor);
+            throw std::runtime_error(path + ": could not map file");
+        }
+        data = static_cast<const char*>(mapping);
+        madvise(mapping, size, sequentialAccess ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fileDescriptor);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+    {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+const char* MappedFile::GetData() const
+{
+    return data;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return size;
+}
+
+/*
+    Parses stations.dat and trains.dat straight out of a memory mapping. Numbers are read with std::from_chars into the output arrays,
+    the only strings created are the station names. Blank lines are skipped, anything else that doesn't match the format throws
+    std::runtime_error with the file, line and column of the problem. Values are checked as well as the syntax: the station ids
+    must be 1 to the number of stations, each once in any order, trips must run between those stations at HHMM times and must
+    not arrive before they leave, the same rules AddTrain applies to trains added at runtime.
+*/
+
+class TimetableReader {
+    public:
+        // Each line is "<id> <name>", output is in file order.
+        static void ReadStations(const std::string& path, std::vector<StationRecord>& stations);
+        // Each line is "<departure id> <destination id> <departure time> <arrival time>", lookUpKey is the trip's line among the trips.
+        // Station ids must be 1 to stationCount.
+        static void ReadTrips(const std::string& path, std::vector<Connection>& trips, int stationCount);
+    private:
+        // Walks one mapped file line by line and keeps track of where it is for error messages.
+        struct Cursor {
+            const std::string& path;
+            const char* position;
+            const char* end;
+            const char* lineStart;
+            int line;
+        };
+        static bool next_line(Cursor& cursor);
+        static void skip_blanks(Cursor& cursor);
+        static int read_int(Cursor& cursor, const char* fieldName);
+        static int read_station_id(Cursor& cursor, const char* fieldName, int stationCount);
+        // An HHMM time, 0000 to 2359. fieldStart is set to where it starts for later errors about the value.
+        static int read_time(Cursor& cursor, const char* fieldName, const char*& fieldStart);
+        static std::string read_word(Cursor& cursor, const char* fieldName);
+        static void expect_line_end(Cursor& cursor);
+        [[noreturn]] static void fail(const Cursor& cursor, const std::string& message);
+        [[noreturn]] static void fail_at(const std::string& path, int line, int column, const std::string& message);
+};
+
+void TimetableReader::ReadStations(const std::string& path, std::vector<StationRecord>& stations)
+{
+    MappedFile file(path);
+    Cursor cursor{path, file.GetData(), file.GetData() + file.GetSize(), file.GetData(), 0};
+
+    // Line and column of each id, the range is only known once every station is read.
+    std::vector<std::pair<int, int>> idPositions;
+    size_t firstStation = stations.size();
+    while (next_line(cursor))
+    {
+        skip_blanks(cursor);
+        idPositions.push_back({cursor.line, (int)(cursor.position - cursor.lineStart) + 1});
+        int stationID = read_int(cursor, "station id");
+        std::string name = read_word(cursor, "station name");
+        expect_line_end(cursor);
+        stations.push_back({stationID, name});
+    }
+
+    int stationCount = idPositions.size();
+    std::vector<int> lineOfID(stationCount + 1, 0);
+    for (int i = 0; i < stationCount; i++)
+    {
+        int stationID = stations[firstStation + i].stationID;
+        if (stationID < 1 || stationID > stationCount)
+        {
+            fail_at(path, idPositions[i].first, idPositions[i].second, "station id " + std::to_string(stationID) +
+                " is out of range, the ids of " + std::to_string(stationCount) + " stations must be 1 to " + std::to_string(stationCount));
+        }
+        if (lineOfID[stationID] != 0)
+        {
+            fail_at(path, idPositions[i].first, idPositions[i].second, "station id " + std::to_string(stationID) +
+                " is already used on line " + std::to_string(lineOfID[stationID]));
+        }
+        lineOfID[stationID] = idPositions[i].first;
+    }
+}
+
+void TimetableReader::ReadTrips(const std::string& path, std::vector<Connection>& trips, int stationCount)
+{
+    MappedFile file(path);
+    Cursor cursor{path, file.GetData(), file.GetData() + file.GetSize(), file.GetData(), 0};
+
+    // Roughly 15 bytes per record, avoids most regrowth on large files.
+    trips.reserve(trips.size() + file.GetSize() / 15);
+    while (next_line(cursor))
+    {
+        Connection trip;
+        trip.lookUpKey = trips.size();
+        trip.departureStationID = read_station_id(cursor, "departure station id", stationCount);
+        trip.arrivalStationID = read_station_id(cursor, "destination station id", stationCount);
+        const char* departureStart = nullptr;
+        const char* arrivalStart = nullptr;
+        trip.departureTime = read_time(cursor, "departure time", departureStart);
+        trip.arrivalTime = read_time(cursor, "arrival time", arrivalStart);
+        if (trip.arrivalTime < trip.departureTime)
+        {
+            cursor.position = arrivalStart;
+            fail(cursor, "arrival time " + std::to_string(trip.arrivalTime) + " is before the departure time " + std::to_string(trip.departureTime));
+        }
+        expect_line_end(cursor);
+        trips.push_back(trip);
+    }
+}
+
+// Moves to the start of the next line that has something on it, returns false at the end of the file.
+bool TimetableReader::next_line(Cursor& cursor)
+{
+    while (cursor.position < cursor.end)
+    {
+        cursor.lineStart = cursor.position;
+        cursor.line++;
+        skip_blanks(cursor);
+
+        if (cursor.position < cursor.end && *cursor.position != '\n')
+        {
+            return true;
+        }
+        // Blank line, step over the newline.
+        cursor.position++;
+    }
+
+    return false;
+}
+
+void TimetableReader::skip_blanks(Cursor& cursor)
+{
+    while (cursor.position < cursor.end && (*cursor.position == ' ' || *cursor.position == '\t' || *cursor.position == '\r'))
+    {
+        cursor.position++;
+    }
+}
+
+int TimetableReader::read_int(Cursor& cursor, const char* fieldName)
+{
+    skip_blanks(cursor);
+
+    int value = 0;
+    std::from_chars_result result = std::from_chars(cursor.position, cursor.end, value);
+    if (result.ec != std::errc() || (result.ptr < cursor.end && !isspace((unsigned char)*result.ptr)))
+    {
+        fail(cursor, std::string("expected ") + fieldName);
+    }
+
+    cursor.position = result.ptr;
+    return value;
+}
+
+int TimetableReader::read_station_id(Cursor& cursor, const char* fieldName, int stationCount)
+{
+    skip_blanks(cursor);
+    const char* fieldStart = cursor.position;
+    int stationID = read_int(cursor, fieldName);
+    if (stationID < 1 || stationID > stationCount)
+    {
+        cursor.position = fieldStart;
+        fail(cursor, std::string(fieldName) + " " + std::to_string(stationID) + " is not a station, ids are 1 to " + std::to_string(stationCount));
+    }
+    return stationID;
+}
+
+int TimetableReader::read_time(Cursor& cursor, const char* fieldName, const char*& fieldStart)
+{
+    skip_blanks(cursor);
+    fieldStart = cursor.position;
+    int twentyFourTime = read_int(cursor, fieldName);
+    if (twentyFourTime < 0 || twentyFourTime > 2359 || twentyFourTime % 100 >= 60)
+    {
+        cursor.position = fieldStart;
+        fail(cursor, std::string(fieldName) + " " + std::to_string(twentyFourTime) + " is not an HHMM time from 0000 to 2359");
+    }
+    return twentyFourTime;
+}
+
+std::string TimetableReader::read_word(Cursor& cursor, const char* fieldName)
+{
+    skip_blanks(cursor);
+
+    const char* wordStart = cursor.position;
+    while (cursor.position < cursor.end && !isspace((unsigned char)*cursor.position))
+    {
+        cursor.position++;
+    }
+
+    if (cursor.position == wordStart)
+    {
+        fail(cursor, std::string("expected ") + fieldName);
+    }
+
+    return std::string(wordStart, cursor.position);
+}
+
+void TimetableReader::expect_line_end(Cursor& cursor)
+{
+    skip_blanks(cursor);
+
+    if (cursor.position < cursor.end && *cursor.position != '\n')
+    {
+        fail(cursor, "unexpected text at end of line");
+    }
+    // Step over the newline so the next call to next_line starts on the following line.
+    if (cursor.position < cursor.end)
+    {
+        cursor.position++;
+    }
+}
+
+void TimetableReader::fail(const Cursor& cursor, const std::string& message)
+{
+    fail_at(cursor.path, cursor.line, (cursor.position - cursor.lineStart) + 1, message);
+}
+
+void TimetableReader::fail_at(const std::string& path, int line, int column, const std::string& message)
+{
+    throw std::runtime_error(path + ":" + std::to_string(line) + ":" + std::to_string(column) + ": " + message);
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <set>
+#include <cstddef>
+#include <algorithm>
+
+// Station sequences of optimal journeys between pairs of stations, built offline by the transfer pattern engine. A pattern lists
+// the departure station, every station where the passenger changes trains and the destination, so a query only has to try the
+// trains running between consecutive stations of each pattern. Patterns are added while building, then Freeze packs them into
+// flat arrays grouped by departure station, so the table grows with the number of connected pairs and patterns rather than with
+// the square of the station count or with trains. A runtime update replaces the patterns of the pairs it may have changed.
+class TransferPatternTable {
+    public:
+        // Ignores a pattern already added for the same pair. Patterns wait for the next Freeze.
+        void AddPattern(const std::vector<int>& stations);
+        // Drops the packed patterns of every pair whose departure and destination stations are both marked, indexed by station id,
+        // when the next Freeze runs. The patterns added in between take their place.
+        void ReplacePairs(const std::vector<char>& departureStations, const std::vector<char>& destinationStations);
+        // Packs the patterns added since the last Freeze in with the packed ones that are kept.
+        void Freeze();
+        int GetPatternCount(int departureStationID, int destinationStationID) const;
+        // Stations of one pattern of the pair, stationsInPattern is set to how many there are.
+        const int* GetPattern(int departureStationID, int destinationStationID, int patternIndex, int& stationsInPattern) const;
+        // Bytes of the table, counting the pending patterns while building.
+        size_t GetBytes() const;
+        TransferPatternTable(int stationsCount);
+    private:
+        const int stationCount;
+        // Patterns of each pair while building, by departure station and then destination. Only pairs with a pattern take room.
+        std::vector<std::map<int, std::set<std::vector<int>>>> pendingPatterns;
+        // Pairs ReplacePairs dropped, empty when none are.
+        std::vector<char> replacedDepartures;
+        std::vector<char> replacedDestinations;
+        // Departure station s has the pairs departureOffsets[s - 1] up to departureOffsets[s], sorted by destination. Pair p goes
+        // to pairDestinations[p] and has the patterns pairOffsets[p] up to pairOffsets[p + 1].
+        std::vector<size_t> departureOffsets;
+        std::vector<int> pairDestinations;
+        std::vector<size_t> pairOffsets;
+        // Pattern p holds the stations from patternOffsets[p] up to patternOffsets[p + 1].
+        std::vector<size_t> patternOffsets;
+        std::vector<int> patternStations;
+        // Index of the pair in pairDestinations, or -1 when the pair has no patterns.
+        ptrdiff_t find_pair(int departureStationID, int destinationStationID) const;
+};
+
+TransferPatternTable::TransferPatternTable(int stationsCount) : stationCount(stationsCount)
+{
+    departureOffsets.assign(stationCount + 1, 0);
+    pairOffsets.assign(1, 0);
+    patternOffsets.assign(1, 0);
+}
+
+ptrdiff_t TransferPatternTable::find_pair(int departureStationID, int destinationStationID) const
+{
+    auto first = pairDestinations.begin() + departureOffsets[departureStationID - 1];
+    auto last = pairDestinations.begin() + departureOffsets[departureStationID];
+    auto pair = std::lower_bound(first, last, destinationStationID);
+    return pair != last && *pair == destinationStationID ? pair - pairDestinations.begin() : -1;
+}
+
+void TransferPatternTable::AddPattern(const std::vector<int>& stations)
+{
+    if (pendingPatterns.empty())
+    {
+        pendingPatterns.resize(stationCount);
+    }
+    pendingPatterns[stations.front() - 1][stations.back()].insert(stations);
+}
+
+void TransferPatternTable::ReplacePairs(const std::vector<char>& departureStations, const std::vector<char>& destinationStations)
+{
+    replacedDepartures = departureStations;
+    replacedDestinations = destinationStations;
+}
+
+void TransferPatternTable::Freeze()
+{
+    std::vector<size_t> packedDepartureOffsets = std::move(departureOffsets);
+    std::vector<int> packedDestinations = std::move(pairDestinations);
+    std::vector<size_t> packedPairOffsets = std::move(pairOffsets);
+    std::vector<size_t> packedPatternOffsets = std::move(patternOffsets);
+    std::vector<int> packedStations = std::move(patternStations);
+    departureOffsets.assign(1, 0);
+    pairDestinations.clear();
+    pairOffsets.assign(1, 0);
+    patternOffsets.assign(1, 0);
+    patternStations.clear();
+
+    // Added and packed pairs are both sorted by destination within a departure station, they are merged one destination at a time.
+    std::map<int, std::set<std::vector<int>>> noPatterns;
+    for (int departureID = 1; departureID <= stationCount; departureID++)
+    {
+        std::map<int, std::set<std::vector<int>>>& added = pendingPatterns.empty() ? noPatterns : pendingPatterns[departureID - 1];
+        auto addedPair = added.begin();
+        size_t packedPair = packedDepartureOffsets[departureID - 1];
+        const size_t packedEnd = packedDepartureOffsets[departureID];
+        while (addedPair != added.end() || packedPair < packedEnd)
+        {
+            bool takeAdded = addedPair != added.end() && (packedPair == packedEnd || addedPair->first <= packedDestinations[packedPair]);
+            int destinationID = takeAdded ? addedPair->first : packedDestinations[packedPair];
+            bool keepPacked = packedPair < packedEnd && packedDestinations[packedPair] == destinationID &&
+                (replacedDepartures.empty() || !replacedDepartures[departureID] || !replacedDestinations[destinationID]);
+
+            if (takeAdded)
+            {
+                std::set<std::vector<int>>& patterns = addedPair->second;
+                if (keepPacked)
+                {
+                    for (size_t pattern = packedPairOffsets[packedPair]; pattern < packedPairOffsets[packedPair + 1]; pattern++)
+                    {
+                        patterns.emplace(packedStations.begin() + packedPatternOffsets[pattern],
+                            packedStations.begin() + packedPatternOffsets[pattern + 1]);
+                    }
+                }
+                for (const std::vector<int>& stations : patterns)
+                {
+                    patternStations.insert(patternStations.end(), stations.begin(), stations.end());
+                    patternOffsets.push_back(patternStations.size());
+                }
+                addedPair++;
+            }
+            else if (keepPacked)
+            {
+                // A kept pair with nothing added is copied as it is, its patterns are already in order.
+                for (size_t pattern = packedPairOffsets[packedPair]; pattern < packedPairOffsets[packedPair + 1]; pattern++)
+                {
+                    patternStations.insert(patternStations.end(), packedStations.begin() + packedPatternOffsets[pattern],
+                        packedStations.begin() + packedPatternOffsets[pattern + 1]);
+                    patternOffsets.push_back(patternStations.size());
+                }
+            }
+            if (packedPair < packedEnd && packedDestinations[packedPair] == destinationID)
+            {
+                packedPair++;
+            }
+
+            if (patternOffsets.size() - 1 > pairOffsets.back())
+            {
+                pairDestinations.push_back(destinationID);
+                pairOffsets.push_back(patternOffsets.size() - 1);
+            }
+        }
+        departureOffsets.push_back(pairDestinations.size());
+    }
+
+    pendingPatterns.clear();
+    pendingPatterns.shrink_to_fit();
+    replacedDepartures.clear();
+    replacedDestinations.clear();
+}
+
+int TransferPatternTable::GetPatternCount(int departureStationID, int destinationStationID) const
+{
+    ptrdiff_t pair = find_pair(departureStationID, destinationStationID);
+    return pair == -1 ? 0 : pairOffsets[pair + 1] - pairOffsets[pair];
+}
+
+const int* TransferPatternTable::GetPattern(int departureStationID, int destinationStationID, int patternIndex, int& stationsInPattern) const
+{
+    size_t pattern = pairOffsets[find_pair(departureStationID, destinationStationID)] + patternIndex;
+    stationsInPattern = patternOffsets[pattern + 1] - patternOffsets[pattern];
+    return patternStations.data() + patternOffsets[pattern];
+}
+
+size_t TransferPatternTable::GetBytes() const
+{
+    size_t bytes = sizeof(TransferPatternTable) + pendingPatterns.capacity() * sizeof(std::map<int, std::set<std::vector<int>>>);
+    for (const std::map<int, std::set<std::vector<int>>>& destinations : pendingPatterns)
+    {
+        for (const auto& [destinationID, patterns] : destinations)
+        {
+            // A tree node holds three pointers and a colour next to its value.
+            bytes += 4 * sizeof(void*) + sizeof(int) + sizeof(std::set<std::vector<int>>);
+            for (const std::vector<int>& stations : patterns)
+            {
+                bytes += 4 * sizeof(void*) + sizeof(std::vector<int>) + stations.capacity() * sizeof(int);
+            }
+        }
+    }
+    return bytes + (departureOffsets.capacity() + pairOffsets.capacity() + patternOffsets.capacity()) * sizeof(size_t) +
+        (pairDestinations.capacity() + patternStations.capacity()) * sizeof(int);
+}
@@ -11,4 +11,13 @@ struct TripPlusLayover{
     int rideTimeToDestinationMins;
     int layoverAtDestinationMins;
     int tripWeight;
-};
\ No newline at end of file
+};
+
+// A single train run as seen by the scan based engines, lookUpKey matches the departure vertex of the same trip.
+struct Connection {
+    int lookUpKey;
+    int departureStationID;
+    int arrivalStationID;
+    int departureTime;
+    int arrivalTime;
+};
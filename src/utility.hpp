@@ -9,7 +9,9 @@ class Utility{
         static bool CompareStringsNoCase(const std::string& s1, const std::string& s2);
         static int GetIntFromUser();
         static void PrintMainMenu();    
-        static const int INF = std::numeric_limits<int>::max();
+        // Converts a clock reading to HHMM, hours 2 to 11 are read as afternoon times.
+        static int ToTwentyFourTime(int hour, int minute);
+        static constexpr int INF = std::numeric_limits<int>::max();
 };
 
 void Utility::ClearInStream()
@@ -32,10 +34,23 @@ void Utility::PrintMainMenu()
     << "(6) - Nonstop service available\n"
     << "(7) - Find route (Shortest riding time)\n"
     << "(8) - Find route (Shortest overall travel time)\n"
-    << "(9) - Find route (Shortest time, at specific departure time)\n"
+    << "(9) - Find route (Earliest arrival, leaving at or after a time)\n"
+    << "(10) - Find routes (Shortest time, by number of transfers)\n"
+    << "(11) - Find routes (Departure window)\n"
+    << "(12) - Departure board\n"
     << "(0) - Exit\n";
 }
 
+int Utility::ToTwentyFourTime(int hour, int minute)
+{
+    if(hour < 12 && hour > 1)
+    {
+        return (hour + 12) * 100 + minute;
+    }
+
+    return hour * 100 + minute;
+}
+
 int Utility::GetIntFromUser()
 {
     int val;